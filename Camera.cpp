@@ -14,8 +14,102 @@ namespace gps {
     }
 
     //return the view matrix, using the glm::lookAt() function
-    glm::mat4 Camera::getViewMatrix() {
-        return glm::lookAt(cameraPosition, cameraPosition + cameraFrontDirection, cameraUpDirection);
+    const glm::mat4& Camera::getViewMatrix() {
+        UpdateMatrices();
+        return this->view;
+    }
+
+    const glm::mat4& Camera::getProjectionMatrix() {
+        UpdateMatrices();
+        return this->projection;
+    }
+
+    const glm::mat4& Camera::getViewProjectionMatrix() {
+        UpdateMatrices();
+        return this->viewProjection;
+    }
+
+    const glm::mat4& Camera::getInverseViewProjectionMatrix() {
+        UpdateMatrices();
+        return this->inverseViewProjection;
+    }
+
+    const glm::vec4* Camera::getFrustumPlanes() {
+        UpdateMatrices();
+        return this->frustumPlanes;
+    }
+
+    bool Camera::isSphereVisible(glm::vec3 center, float radius) {
+        UpdateMatrices();
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            if (glm::dot(glm::vec3(frustumPlanes[i]), center) + frustumPlanes[i].w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    float Camera::getFov() {
+        return this->fov;
+    }
+
+    void Camera::setFov(float degrees) {
+        if (degrees != this->fov) {
+            this->fov = degrees;
+            this->projectionDirty = true;
+        }
+    }
+
+    float Camera::getAspect() {
+        return this->aspect;
+    }
+
+    void Camera::setAspect(float aspect) {
+        if (aspect != this->aspect) {
+            this->aspect = aspect;
+            this->projectionDirty = true;
+        }
+    }
+
+    float Camera::getNearPlane() {
+        return this->nearPlane;
+    }
+
+    float Camera::getFarPlane() {
+        return this->farPlane;
+    }
+
+    void Camera::setClipPlanes(float nearPlane, float farPlane) {
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+        this->projectionDirty = true;
+    }
+
+    void Camera::UpdateMatrices() {
+        if (!viewDirty && !projectionDirty)
+            return;
+
+        if (viewDirty)
+            this->view = glm::lookAt(cameraPosition, cameraPosition + cameraFrontDirection, cameraUpDirection);
+        if (projectionDirty)
+            this->projection = glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
+        viewDirty = false;
+        projectionDirty = false;
+
+        this->viewProjection = projection * view;
+        this->inverseViewProjection = glm::inverse(viewProjection);
+
+        //rows of the view projection matrix added to and taken from the last one (Gribb and Hartmann)
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        frustumPlanes[PLANE_LEFT] = rows[3] + rows[0];
+        frustumPlanes[PLANE_RIGHT] = rows[3] - rows[0];
+        frustumPlanes[PLANE_BOTTOM] = rows[3] + rows[1];
+        frustumPlanes[PLANE_TOP] = rows[3] - rows[1];
+        frustumPlanes[PLANE_NEAR] = rows[3] + rows[2];
+        frustumPlanes[PLANE_FAR] = rows[3] - rows[2];
+        for (int i = 0; i < PLANE_COUNT; i++)
+            frustumPlanes[i] /= glm::length(glm::vec3(frustumPlanes[i]));
     }
 
     glm::vec3 Camera::getFront() {
@@ -28,10 +122,12 @@ namespace gps {
 
     void Camera::setPosition(glm::vec3 pos) {
         this->cameraPosition = pos;
+        this->viewDirty = true;
     }
 
     void Camera::setFront(glm::vec3 pos) {
         this->cameraFrontDirection = pos;
+        this->viewDirty = true;
     }
 
     //update the camera internal parameters following a camera move event
@@ -48,6 +144,7 @@ namespace gps {
             this->cameraPosition += cameraUpDirection * speed;
         if (direction == MOVE_DOWN)
             this->cameraPosition -= cameraUpDirection * speed;
+        this->viewDirty = true;
     }
 
     //reset camera position
@@ -55,6 +152,7 @@ namespace gps {
         this->cameraPosition = glm::vec3(0.0f, 0.0f, 3.0f);
         this->cameraTarget = glm::vec3(0.0f, 0.0f, -10.0f);
         this->cameraUpDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+        this->viewDirty = true;
     }
    
     //update the camera internal parameters following a camera rotate event
@@ -69,6 +167,6 @@ namespace gps {
 
         this->cameraFrontDirection = glm::normalize(direction);
         this->cameraRightDirection = glm::normalize(glm::cross(this->cameraFrontDirection, this->cameraUpDirection));
-
+        this->viewDirty = true;
     }
 }
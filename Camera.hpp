@@ -7,6 +7,9 @@
 namespace gps {
     
     enum MOVE_DIRECTION {MOVE_FORWARD, MOVE_BACKWARD, MOVE_RIGHT, MOVE_LEFT, MOVE_UP, MOVE_DOWN};
+
+    // planes of the view frustum, normals point inside
+    enum FRUSTUM_PLANE {PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT};
     
     class Camera {
 
@@ -14,7 +17,25 @@ namespace gps {
         //Camera constructor
         Camera(glm::vec3 cameraPosition, glm::vec3 cameraTarget, glm::vec3 cameraUp);
         //return the view matrix, using the glm::lookAt() function
-        glm::mat4 getViewMatrix();
+        //the matrices and planes are rebuilt on the first call after the camera changed
+        const glm::mat4& getViewMatrix();
+        const glm::mat4& getProjectionMatrix();
+        const glm::mat4& getViewProjectionMatrix();
+        const glm::mat4& getInverseViewProjectionMatrix();
+        //world space planes as (normal, distance), normalized so a dot product is a distance
+        const glm::vec4* getFrustumPlanes();
+        //false when the sphere is entirely outside one of the planes
+        bool isSphereVisible(glm::vec3 center, float radius);
+
+        //vertical field of view in degrees
+        float getFov();
+        void setFov(float degrees);
+        float getAspect();
+        void setAspect(float aspect);
+        float getNearPlane();
+        float getFarPlane();
+        void setClipPlanes(float nearPlane, float farPlane);
+
         glm::vec3 getFront();
         glm::vec3 getPosition();
         void setPosition(glm::vec3 pos);
@@ -34,6 +55,22 @@ namespace gps {
         glm::vec3 cameraFrontDirection;
         glm::vec3 cameraRightDirection;
         glm::vec3 cameraUpDirection;
+
+        float fov = 45.0f;
+        float aspect = 1.0f;
+        float nearPlane = 0.1f;
+        float farPlane = 100.0f;
+
+        //set by every change, cleared once the cache is rebuilt
+        bool viewDirty = true;
+        bool projectionDirty = true;
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::mat4 inverseViewProjection;
+        glm::vec4 frustumPlanes[PLANE_COUNT];
+
+        void UpdateMatrices();
     };    
 }
 
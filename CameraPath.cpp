@@ -0,0 +1,272 @@
+#include "CameraPath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gps {
+
+    namespace {
+
+        // cubic Hermite between a and b, tangents in units per second over a span of h seconds
+        template <typename T>
+        T hermite(const T& a, const T& tangentA, const T& b, const T& tangentB, float h, float s) {
+
+            float s2 = s * s;
+            float s3 = s2 * s;
+            return a * (2.0f * s3 - 3.0f * s2 + 1.0f) + tangentA * (h * (s3 - 2.0f * s2 + s))
+                + b * (3.0f * s2 - 2.0f * s3) + tangentB * (h * (s3 - s2));
+        }
+
+        bool isEarlier(double time, const CameraKeyframe& keyframe) {
+
+            return time < keyframe.time;
+        }
+
+        bool isShorter(float distance, const CameraKeyframe& keyframe) {
+
+            return distance < keyframe.distance;
+        }
+    }
+
+    bool CameraPath::Load(const std::string& fileName) {
+
+        keyframes.clear();
+        arcLengths.clear();
+        shotStarts.clear();
+        constantSpeed = false;
+
+        std::ifstream file(fileName);
+        if (!file) {
+            std::cout << "Camera path " << fileName << " not found" << std::endl;
+            return false;
+        }
+
+        std::vector<bool> hermite;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            std::istringstream values(line);
+            std::string word;
+            values >> word;
+            if (word == "speed") {
+                values >> word;
+                if (word != "constant" && word != "keyframes") {
+                    std::cout << "Camera path " << fileName << ": unknown speed on line " << lineNumber << std::endl;
+                    keyframes.clear();
+                    return false;
+                }
+                constantSpeed = word == "constant";
+                continue;
+            }
+
+            values.str(line);
+            values.clear();
+            std::vector<double> numbers;
+            double number;
+            while (values >> number) {
+                numbers.push_back(number);
+            }
+
+            //eight values, or eleven for a Hermite keyframe, times in order
+            bool valid = values.eof() && (numbers.size() == 8 || numbers.size() == 11)
+                && (keyframes.empty() || numbers[0] >= keyframes.back().time);
+            glm::vec3 front = valid ? glm::vec3((float)numbers[4], (float)numbers[5], (float)numbers[6]) : glm::vec3(0.0f);
+            if (!valid || glm::length(front) == 0.0f) {
+                std::cout << "Camera path " << fileName << ": bad keyframe on line " << lineNumber << std::endl;
+                keyframes.clear();
+                return false;
+            }
+
+            CameraKeyframe keyframe;
+            keyframe.time = numbers[0];
+            keyframe.position = glm::vec3((float)numbers[1], (float)numbers[2], (float)numbers[3]);
+            keyframe.orientation = getOrientation(front);
+            keyframe.fov = (float)numbers[7];
+            keyframe.positionTangent = numbers.size() == 11 ? glm::vec3((float)numbers[8], (float)numbers[9], (float)numbers[10]) : glm::vec3(0.0f);
+            keyframe.fovTangent = 0.0f;
+            keyframe.distance = 0.0f;
+            keyframes.push_back(keyframe);
+            hermite.push_back(numbers.size() == 11);
+        }
+
+        if (keyframes.size() < 2) {
+            std::cout << "Camera path " << fileName << " needs at least two keyframes" << std::endl;
+            keyframes.clear();
+            return false;
+        }
+
+        Build(hermite);
+        return true;
+    }
+
+    void CameraPath::Build(const std::vector<bool>& hermite) {
+
+        for (size_t i = 0; i < keyframes.size(); i++) {
+
+            size_t previous, next;
+            getNeighbours(i, previous, next);
+            double span = keyframes[next].time - keyframes[previous].time;
+            if (span <= 0.0) {
+                continue;
+            }
+            if (!hermite[i]) {
+                keyframes[i].positionTangent = (keyframes[next].position - keyframes[previous].position) / (float)span;
+            }
+            keyframes[i].fovTangent = (keyframes[next].fov - keyframes[previous].fov) / (float)span;
+        }
+
+        //chords between samples of every span, summed from the start of the shot
+        arcLengths.assign((keyframes.size() - 1) * (ARC_SAMPLES + 1), 0.0f);
+        shotStarts.assign(1, 0);
+        for (size_t i = 0; i + 1 < keyframes.size(); i++) {
+
+            float* samples = &arcLengths[i * (ARC_SAMPLES + 1)];
+            if (keyframes[i + 1].time == keyframes[i].time) {
+                keyframes[i + 1].distance = 0.0f;
+                shotStarts.push_back(i + 1);
+                continue;
+            }
+
+            samples[0] = keyframes[i].distance;
+            glm::vec3 last = keyframes[i].position;
+            for (int j = 1; j <= ARC_SAMPLES; j++) {
+                glm::vec3 point = getSplinePosition(i, (float)j / ARC_SAMPLES);
+                samples[j] = samples[j - 1] + glm::length(point - last);
+                last = point;
+            }
+            keyframes[i + 1].distance = samples[ARC_SAMPLES];
+        }
+    }
+
+    void CameraPath::getNeighbours(size_t i, size_t& previous, size_t& next) {
+
+        //a keyframe sharing its time with a neighbour is the end of a shot
+        previous = (i > 0 && keyframes[i - 1].time < keyframes[i].time) ? i - 1 : i;
+        next = (i + 1 < keyframes.size() && keyframes[i + 1].time > keyframes[i].time) ? i + 1 : i;
+    }
+
+    glm::vec3 CameraPath::getSplinePosition(size_t begin, float s) {
+
+        const CameraKeyframe& a = keyframes[begin];
+        const CameraKeyframe& b = keyframes[begin + 1];
+        return hermite(a.position, a.positionTangent, b.position, b.positionTangent, (float)(b.time - a.time), s);
+    }
+
+    double CameraPath::getConstantSpeedTime(double time) {
+
+        //the shot holding the time, it ends where the next one starts
+        std::vector<size_t>::iterator nextShot = std::upper_bound(shotStarts.begin(), shotStarts.end(), time,
+            [this](double t, size_t start) { return t < keyframes[start].time; });
+        if (nextShot == shotStarts.begin()) {
+            return time;
+        }
+        size_t first = *(nextShot - 1);
+        size_t last = nextShot == shotStarts.end() ? keyframes.size() - 1 : *nextShot - 1;
+        double start = keyframes[first].time;
+        double end = keyframes[last].time;
+        float length = keyframes[last].distance;
+        if (end <= start || time >= end || length <= 0.0f) {
+            return time;
+        }
+
+        //the span and then the sample the distance falls in
+        float distance = length * (float)((time - start) / (end - start));
+        size_t span = std::upper_bound(keyframes.begin() + first, keyframes.begin() + last + 1, distance, isShorter) - keyframes.begin();
+        span = std::min(std::max(span, first + 1), last) - 1;
+        const float* samples = &arcLengths[span * (ARC_SAMPLES + 1)];
+        int sample = (int)(std::upper_bound(samples, samples + ARC_SAMPLES + 1, distance) - samples);
+        sample = std::min(std::max(sample, 1), (int)ARC_SAMPLES);
+
+        float chord = samples[sample] - samples[sample - 1];
+        float along = chord > 0.0f ? (distance - samples[sample - 1]) / chord : 0.0f;
+        double s = (sample - 1 + along) / ARC_SAMPLES;
+        return keyframes[span].time + s * (keyframes[span + 1].time - keyframes[span].time);
+    }
+
+    void CameraPath::Evaluate(double time, glm::vec3& position, glm::quat& orientation, float& fov) {
+
+        if (keyframes.empty()) {
+            return;
+        }
+
+        double duration = getDuration();
+        if (duration > 0.0) {
+            time = std::fmod(time, duration);
+            if (time < 0.0) {
+                time += duration;
+            }
+        }
+        if (constantSpeed) {
+            time = getConstantSpeedTime(time);
+        }
+
+        //the first keyframe later than the time, the one before it starts the span
+        size_t end = std::upper_bound(keyframes.begin(), keyframes.end(), time, isEarlier) - keyframes.begin();
+        if (end == 0 || end == keyframes.size()) {
+            const CameraKeyframe& held = keyframes[end == 0 ? 0 : end - 1];
+            position = held.position;
+            orientation = held.orientation;
+            fov = held.fov;
+            return;
+        }
+
+        const CameraKeyframe& a = keyframes[end - 1];
+        const CameraKeyframe& b = keyframes[end];
+        float s = (float)((time - a.time) / (b.time - a.time));
+        position = getSplinePosition(end - 1, s);
+        //glm::slerp goes the short way around, whatever the signs of the keyframes
+        orientation = glm::slerp(a.orientation, b.orientation, s);
+        fov = hermite(a.fov, a.fovTangent, b.fov, b.fovTangent, (float)(b.time - a.time), s);
+    }
+
+    void CameraPath::Apply(Camera& camera, double time) {
+
+        glm::vec3 position;
+        glm::quat orientation;
+        float fov;
+        Evaluate(time, position, orientation, fov);
+        camera.setPosition(position);
+        camera.setFront(getFront(orientation));
+        camera.setFov(fov);
+    }
+
+    glm::vec3 CameraPath::getFront(const glm::quat& orientation) {
+
+        return glm::normalize(orientation * glm::vec3(0.0f, 0.0f, -1.0f));
+    }
+
+    glm::quat CameraPath::getOrientation(glm::vec3 front) {
+
+        front = glm::normalize(front);
+        glm::vec3 right = glm::cross(front, glm::vec3(0.0f, 1.0f, 0.0f));
+        //straight up or down, any right vector will do
+        right = glm::length(right) < 1e-5f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::normalize(right);
+        glm::vec3 up = glm::cross(right, front);
+        return glm::normalize(glm::quat_cast(glm::mat3(right, up, -front)));
+    }
+
+    double CameraPath::getDuration() {
+
+        return keyframes.empty() ? 0.0 : keyframes.back().time;
+    }
+
+    int CameraPath::getKeyframeCount() {
+
+        return (int)keyframes.size();
+    }
+
+    bool CameraPath::isConstantSpeed() {
+
+        return constantSpeed;
+    }
+}
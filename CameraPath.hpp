@@ -0,0 +1,79 @@
+#ifndef CameraPath_hpp
+#define CameraPath_hpp
+
+#include "Camera.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    struct CameraKeyframe {
+        // seconds from the start of the path
+        double time;
+        glm::vec3 position;
+        // turns -z into the view direction, the camera keeps its up along +y
+        glm::quat orientation;
+        // vertical field of view in degrees
+        float fov;
+        // units per second, given in the file for a Hermite keyframe or taken from the neighbours
+        glm::vec3 positionTangent;
+        float fovTangent;
+        // distance flown since the start of the shot, for constant speed
+        float distance;
+    };
+
+    // A keyframed camera flight read from a text file and evaluated at a time, never from frame
+    // counts, so it plays the same at any frame rate.
+    // Every line holds "time px py pz fx fy fz fov", '#' starts a comment. Three more values
+    // "tx ty tz" make it a Hermite keyframe with that velocity, the others get Catmull-Rom tangents,
+    // the finite differences over time of their neighbours. Orientations are slerped.
+    // Two keyframes with the same time are a cut: the spline ends at the first and starts again at the second.
+    // A "speed constant" line flies every shot at one speed over its length, keeping only the
+    // start and end time of the shot, "speed keyframes" (the default) passes every keyframe at its time.
+    // Evaluation is two binary searches, one over the keyframes and one in the arc length table of a span.
+    class CameraPath {
+
+    public:
+        // samples of the arc length table per span between two keyframes
+        static const int ARC_SAMPLES = 64;
+
+        // false when the file is missing or has fewer than two keyframes, times must not decrease
+        bool Load(const std::string& fileName);
+
+        // time wraps around the duration of the path
+        void Evaluate(double time, glm::vec3& position, glm::quat& orientation, float& fov);
+        // position, direction and field of view of the camera at that time
+        void Apply(Camera& camera, double time);
+
+        double getDuration();
+        int getKeyframeCount();
+        bool isConstantSpeed();
+
+        // view direction of an orientation and the orientation looking along a direction
+        static glm::vec3 getFront(const glm::quat& orientation);
+        static glm::quat getOrientation(glm::vec3 front);
+
+    private:
+        std::vector<CameraKeyframe> keyframes;
+        // ARC_SAMPLES + 1 distances per span from the start of its shot, span i starts at keyframes[i]
+        std::vector<float> arcLengths;
+        // first keyframe of every shot
+        std::vector<size_t> shotStarts;
+        bool constantSpeed = false;
+
+        // tangents of the Catmull-Rom keyframes and the arc length table
+        void Build(const std::vector<bool>& hermite);
+        // the keyframes on both sides of i within its shot, i itself at the ends of a shot
+        void getNeighbours(size_t i, size_t& previous, size_t& next);
+        // span starting at begin, s from 0 to 1 over it
+        glm::vec3 getSplinePosition(size_t begin, float s);
+        // the time at which the keyframed curve has flown the same share of its shot as time has of the shot duration
+        double getConstantSpeedTime(double time);
+    };
+}
+
+#endif /* CameraPath_hpp */
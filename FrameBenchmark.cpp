@@ -0,0 +1,206 @@
+#include "FrameBenchmark.hpp"
+#include "RenderBackend.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace gps {
+
+    namespace {
+
+        double elapsedMs(std::chrono::steady_clock::time_point start) {
+
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::string quote(const std::string& text) {
+
+            std::string quoted = "\"";
+            for (size_t i = 0; i < text.size(); i++) {
+                if (text[i] == '"' || text[i] == '\\') {
+                    quoted += '\\';
+                }
+                //control characters have no place in a renderer name, they are dropped
+                if ((unsigned char)text[i] >= 0x20) {
+                    quoted += text[i];
+                }
+            }
+            return quoted + "\"";
+        }
+
+        void writeStatistics(std::ostream& out, const char* name, const FrameStatistics& statistics) {
+
+            out << "  \"" << name << "\": { \"mean\": " << statistics.mean << ", \"p50\": " << statistics.p50
+                << ", \"p95\": " << statistics.p95 << ", \"p99\": " << statistics.p99 << ", \"max\": " << statistics.max << " },\n";
+        }
+
+        void writeValues(std::ostream& out, const char* name, const std::vector<double>& values, bool last) {
+
+            out << "    \"" << name << "\": [";
+            for (size_t i = 0; i < values.size(); i++) {
+                out << (i == 0 ? "" : ", ") << values[i];
+            }
+            out << "]" << (last ? "\n" : ",\n");
+        }
+    }
+
+    void FrameBenchmark::Create(int frameCount) {
+
+        this->frameCount = frameCount;
+        recordedFrames = 0;
+        queries.assign((size_t)frameCount * 2, 0);
+        RenderBackend::getCurrent().GenQueries((GLsizei)queries.size(), queries.data());
+        cpuMs.assign(frameCount, 0.0);
+        gpuMs.assign(frameCount, 0.0);
+        frameMs.assign(frameCount, 0.0);
+        properties.clear();
+    }
+
+    void FrameBenchmark::Delete() {
+
+        if (!queries.empty()) {
+            RenderBackend::getCurrent().DeleteQueries((GLsizei)queries.size(), queries.data());
+        }
+        queries.clear();
+        frameCount = 0;
+        recordedFrames = 0;
+    }
+
+    void FrameBenchmark::BeginFrame() {
+
+        if (isFinished()) {
+            return;
+        }
+
+        frameStart = std::chrono::steady_clock::now();
+        RenderBackend::getCurrent().QueryCounter(queries[recordedFrames * 2], GL_TIMESTAMP);
+    }
+
+    void FrameBenchmark::EndCommands() {
+
+        if (isFinished()) {
+            return;
+        }
+
+        RenderBackend::getCurrent().QueryCounter(queries[recordedFrames * 2 + 1], GL_TIMESTAMP);
+        cpuMs[recordedFrames] = elapsedMs(frameStart);
+    }
+
+    void FrameBenchmark::EndFrame() {
+
+        if (isFinished()) {
+            return;
+        }
+
+        frameMs[recordedFrames] = elapsedMs(frameStart);
+        recordedFrames++;
+    }
+
+    bool FrameBenchmark::isFinished() {
+
+        return recordedFrames >= frameCount;
+    }
+
+    int FrameBenchmark::getRecordedFrames() {
+
+        return recordedFrames;
+    }
+
+    void FrameBenchmark::setProperty(const std::string& name, const std::string& value) {
+
+        properties.push_back(std::make_pair(name, quote(value)));
+    }
+
+    void FrameBenchmark::setProperty(const std::string& name, double value) {
+
+        std::ostringstream text;
+        text << value;
+        properties.push_back(std::make_pair(name, text.str()));
+    }
+
+    void FrameBenchmark::ReadQueries() {
+
+        //blocks until the GPU reached the last timestamp, the others are done by then
+        RenderBackend& backend = RenderBackend::getCurrent();
+        for (int i = 0; i < recordedFrames; i++) {
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            backend.GetQueryObjectui64v(queries[i * 2], GL_QUERY_RESULT, &begin);
+            backend.GetQueryObjectui64v(queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+            gpuMs[i] = end > begin ? (end - begin) / 1000000.0 : 0.0;
+        }
+    }
+
+    FrameStatistics FrameBenchmark::summarize(std::vector<double> values) {
+
+        FrameStatistics statistics = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+        if (values.empty()) {
+            return statistics;
+        }
+
+        std::sort(values.begin(), values.end());
+        double total = 0.0;
+        for (size_t i = 0; i < values.size(); i++) {
+            total += values[i];
+        }
+
+        //nearest rank, the smallest value at or above the given share of the frames
+        size_t count = values.size();
+        double percentiles[3] = { 50.0, 95.0, 99.0 };
+        double* results[3] = { &statistics.p50, &statistics.p95, &statistics.p99 };
+        for (int i = 0; i < 3; i++) {
+            size_t rank = (size_t)std::ceil(percentiles[i] / 100.0 * count);
+            *results[i] = values[std::min(std::max(rank, (size_t)1), count) - 1];
+        }
+        statistics.mean = total / count;
+        statistics.max = values.back();
+        return statistics;
+    }
+
+    FrameStatistics FrameBenchmark::getCpuStatistics() {
+
+        return summarize(std::vector<double>(cpuMs.begin(), cpuMs.begin() + recordedFrames));
+    }
+
+    FrameStatistics FrameBenchmark::getGpuStatistics() {
+
+        return summarize(std::vector<double>(gpuMs.begin(), gpuMs.begin() + recordedFrames));
+    }
+
+    FrameStatistics FrameBenchmark::getFrameStatistics() {
+
+        return summarize(std::vector<double>(frameMs.begin(), frameMs.begin() + recordedFrames));
+    }
+
+    bool FrameBenchmark::Write(const std::string& fileName) {
+
+        ReadQueries();
+
+        std::ofstream out(fileName);
+        if (!out) {
+            return false;
+        }
+
+        out << "{\n";
+        for (size_t i = 0; i < properties.size(); i++) {
+            out << "  " << quote(properties[i].first) << ": " << properties[i].second << ",\n";
+        }
+        out << "  \"frames\": " << recordedFrames << ",\n";
+        writeStatistics(out, "cpuMs", getCpuStatistics());
+        writeStatistics(out, "gpuMs", getGpuStatistics());
+        writeStatistics(out, "frameMs", getFrameStatistics());
+
+        std::vector<double> recordedCpu(cpuMs.begin(), cpuMs.begin() + recordedFrames);
+        std::vector<double> recordedGpu(gpuMs.begin(), gpuMs.begin() + recordedFrames);
+        std::vector<double> recordedFrame(frameMs.begin(), frameMs.begin() + recordedFrames);
+        out << "  \"perFrame\": {\n";
+        writeValues(out, "cpuMs", recordedCpu, false);
+        writeValues(out, "gpuMs", recordedGpu, false);
+        writeValues(out, "frameMs", recordedFrame, true);
+        out << "  }\n}\n";
+
+        return out.good();
+    }
+}
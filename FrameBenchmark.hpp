@@ -0,0 +1,79 @@
+#ifndef FrameBenchmark_hpp
+#define FrameBenchmark_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    // milliseconds over the recorded frames
+    struct FrameStatistics {
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    // Records CPU, GPU and whole frame times of a fixed number of frames and writes them to JSON.
+    // The GPU time of a frame is the difference of two GL_TIMESTAMP queries, so it can wrap passes
+    // that are timed by a GpuTimer. Nothing is read back before the last frame, the queries of
+    // every frame are kept until then.
+    class FrameBenchmark {
+
+    public:
+        void Create(int frameCount);
+        void Delete();
+
+        // at the top of the frame
+        void BeginFrame();
+        // after the last command of the frame, before the swap, ends the CPU time
+        void EndCommands();
+        // after the swap, ends the frame time
+        void EndFrame();
+
+        bool isFinished();
+        int getRecordedFrames();
+
+        // written before the timings, to tell runs on other builds and machines apart
+        void setProperty(const std::string& name, const std::string& value);
+        void setProperty(const std::string& name, double value);
+
+        // waits for the queries of the last frames, then writes the properties, the statistics and every frame
+        bool Write(const std::string& fileName);
+
+        FrameStatistics getCpuStatistics();
+        // the GPU times are read back by Write()
+        FrameStatistics getGpuStatistics();
+        FrameStatistics getFrameStatistics();
+
+        // nearest rank percentiles of a sorted copy
+        static FrameStatistics summarize(std::vector<double> values);
+
+    private:
+        int frameCount = 0;
+        int recordedFrames = 0;
+        // a begin and an end timestamp per frame
+        std::vector<GLuint> queries;
+        std::vector<double> cpuMs;
+        std::vector<double> gpuMs;
+        std::vector<double> frameMs;
+        std::chrono::steady_clock::time_point frameStart;
+        // names and values already in JSON
+        std::vector<std::pair<std::string, std::string> > properties;
+
+        void ReadQueries();
+    };
+}
+
+#endif /* FrameBenchmark_hpp */
@@ -0,0 +1,409 @@
+#include "GLRenderBackend.hpp"
+
+namespace gps {
+
+    GLuint GLRenderBackend::CreateShader(GLenum type) {
+
+        return glCreateShader(type);
+    }
+
+    void GLRenderBackend::ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+
+        glShaderSource(shader, count, strings, lengths);
+    }
+
+    void GLRenderBackend::CompileShader(GLuint shader) {
+
+        glCompileShader(shader);
+    }
+
+    void GLRenderBackend::GetShaderiv(GLuint shader, GLenum name, GLint* value) {
+
+        glGetShaderiv(shader, name, value);
+    }
+
+    void GLRenderBackend::GetShaderInfoLog(GLuint shader, GLsizei size, GLsizei* length, GLchar* log) {
+
+        glGetShaderInfoLog(shader, size, length, log);
+    }
+
+    void GLRenderBackend::DeleteShader(GLuint shader) {
+
+        glDeleteShader(shader);
+    }
+
+    GLuint GLRenderBackend::CreateProgram() {
+
+        return glCreateProgram();
+    }
+
+    void GLRenderBackend::AttachShader(GLuint program, GLuint shader) {
+
+        glAttachShader(program, shader);
+    }
+
+    void GLRenderBackend::LinkProgram(GLuint program) {
+
+        glLinkProgram(program);
+    }
+
+    void GLRenderBackend::ProgramParameteri(GLuint program, GLenum name, GLint value) {
+
+        glProgramParameteri(program, name, value);
+    }
+
+    void GLRenderBackend::GetProgramiv(GLuint program, GLenum name, GLint* value) {
+
+        glGetProgramiv(program, name, value);
+    }
+
+    void GLRenderBackend::GetProgramInfoLog(GLuint program, GLsizei size, GLsizei* length, GLchar* log) {
+
+        glGetProgramInfoLog(program, size, length, log);
+    }
+
+    void GLRenderBackend::ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length) {
+
+        glProgramBinary(program, format, binary, length);
+    }
+
+    void GLRenderBackend::GetProgramBinary(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary) {
+
+        glGetProgramBinary(program, size, length, format, binary);
+    }
+
+    void GLRenderBackend::DeleteProgram(GLuint program) {
+
+        glDeleteProgram(program);
+    }
+
+    void GLRenderBackend::UseProgram(GLuint program) {
+
+        glUseProgram(program);
+    }
+
+    GLint GLRenderBackend::GetUniformLocation(GLuint program, const GLchar* name) {
+
+        return glGetUniformLocation(program, name);
+    }
+
+    void GLRenderBackend::Uniform1i(GLint location, GLint value) {
+
+        glUniform1i(location, value);
+    }
+
+    void GLRenderBackend::Uniform1f(GLint location, GLfloat value) {
+
+        glUniform1f(location, value);
+    }
+
+    void GLRenderBackend::Uniform2f(GLint location, GLfloat x, GLfloat y) {
+
+        glUniform2f(location, x, y);
+    }
+
+    void GLRenderBackend::Uniform3fv(GLint location, GLsizei count, const GLfloat* values) {
+
+        glUniform3fv(location, count, values);
+    }
+
+    void GLRenderBackend::UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) {
+
+        glUniformMatrix3fv(location, count, transpose, values);
+    }
+
+    void GLRenderBackend::UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) {
+
+        glUniformMatrix4fv(location, count, transpose, values);
+    }
+
+    void GLRenderBackend::GenVertexArrays(GLsizei count, GLuint* arrays) {
+
+        glGenVertexArrays(count, arrays);
+    }
+
+    void GLRenderBackend::DeleteVertexArrays(GLsizei count, const GLuint* arrays) {
+
+        glDeleteVertexArrays(count, arrays);
+    }
+
+    void GLRenderBackend::BindVertexArray(GLuint array) {
+
+        glBindVertexArray(array);
+    }
+
+    void GLRenderBackend::GenBuffers(GLsizei count, GLuint* buffers) {
+
+        glGenBuffers(count, buffers);
+    }
+
+    void GLRenderBackend::DeleteBuffers(GLsizei count, const GLuint* buffers) {
+
+        glDeleteBuffers(count, buffers);
+    }
+
+    void GLRenderBackend::BindBuffer(GLenum target, GLuint buffer) {
+
+        glBindBuffer(target, buffer);
+    }
+
+    void GLRenderBackend::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+
+        glBufferData(target, size, data, usage);
+    }
+
+    void GLRenderBackend::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+
+        glBufferSubData(target, offset, size, data);
+    }
+
+    void* GLRenderBackend::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+
+        return glMapBufferRange(target, offset, length, access);
+    }
+
+    GLboolean GLRenderBackend::UnmapBuffer(GLenum target) {
+
+        return glUnmapBuffer(target);
+    }
+
+    void GLRenderBackend::EnableVertexAttribArray(GLuint index) {
+
+        glEnableVertexAttribArray(index);
+    }
+
+    void GLRenderBackend::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset) {
+
+        glVertexAttribPointer(index, size, type, normalized, stride, offset);
+    }
+
+    void GLRenderBackend::VertexAttribDivisor(GLuint index, GLuint divisor) {
+
+        glVertexAttribDivisor(index, divisor);
+    }
+
+    void GLRenderBackend::GenTextures(GLsizei count, GLuint* textures) {
+
+        glGenTextures(count, textures);
+    }
+
+    void GLRenderBackend::DeleteTextures(GLsizei count, const GLuint* textures) {
+
+        glDeleteTextures(count, textures);
+    }
+
+    void GLRenderBackend::ActiveTexture(GLenum unit) {
+
+        glActiveTexture(unit);
+    }
+
+    void GLRenderBackend::BindTexture(GLenum target, GLuint texture) {
+
+        glBindTexture(target, texture);
+    }
+
+    void GLRenderBackend::TexParameteri(GLenum target, GLenum name, GLint value) {
+
+        glTexParameteri(target, name, value);
+    }
+
+    void GLRenderBackend::TexParameteriv(GLenum target, GLenum name, const GLint* values) {
+
+        glTexParameteriv(target, name, values);
+    }
+
+    void GLRenderBackend::TexParameterfv(GLenum target, GLenum name, const GLfloat* values) {
+
+        glTexParameterfv(target, name, values);
+    }
+
+    void GLRenderBackend::TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* data) {
+
+        glTexImage2D(target, level, internalFormat, width, height, border, format, type, data);
+    }
+
+    void GLRenderBackend::CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei size, const void* data) {
+
+        glCompressedTexImage2D(target, level, internalFormat, width, height, border, size, data);
+    }
+
+    void GLRenderBackend::TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data) {
+
+        glTexSubImage2D(target, level, x, y, width, height, format, type, data);
+    }
+
+    void GLRenderBackend::CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei size, const void* data) {
+
+        glCompressedTexSubImage2D(target, level, x, y, width, height, format, size, data);
+    }
+
+    void GLRenderBackend::GenerateMipmap(GLenum target) {
+
+        glGenerateMipmap(target);
+    }
+
+    void GLRenderBackend::TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) {
+
+        glTexBuffer(target, internalFormat, buffer);
+    }
+
+    void GLRenderBackend::PixelStorei(GLenum name, GLint value) {
+
+        glPixelStorei(name, value);
+    }
+
+    void GLRenderBackend::GenFramebuffers(GLsizei count, GLuint* framebuffers) {
+
+        glGenFramebuffers(count, framebuffers);
+    }
+
+    void GLRenderBackend::BindFramebuffer(GLenum target, GLuint framebuffer) {
+
+        glBindFramebuffer(target, framebuffer);
+    }
+
+    void GLRenderBackend::FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) {
+
+        glFramebufferTexture2D(target, attachment, textureTarget, texture, level);
+    }
+
+    void GLRenderBackend::DrawBuffer(GLenum buffer) {
+
+        glDrawBuffer(buffer);
+    }
+
+    void GLRenderBackend::ReadBuffer(GLenum buffer) {
+
+        glReadBuffer(buffer);
+    }
+
+    void GLRenderBackend::Enable(GLenum capability) {
+
+        glEnable(capability);
+    }
+
+    void GLRenderBackend::ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+
+        glClearColor(red, green, blue, alpha);
+    }
+
+    void GLRenderBackend::Clear(GLbitfield mask) {
+
+        glClear(mask);
+    }
+
+    void GLRenderBackend::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+
+        glViewport(x, y, width, height);
+    }
+
+    void GLRenderBackend::DepthFunc(GLenum func) {
+
+        glDepthFunc(func);
+    }
+
+    void GLRenderBackend::DepthMask(GLboolean flag) {
+
+        glDepthMask(flag);
+    }
+
+    void GLRenderBackend::ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+
+        glColorMask(red, green, blue, alpha);
+    }
+
+    void GLRenderBackend::CullFace(GLenum mode) {
+
+        glCullFace(mode);
+    }
+
+    void GLRenderBackend::FrontFace(GLenum mode) {
+
+        glFrontFace(mode);
+    }
+
+    void GLRenderBackend::PolygonMode(GLenum face, GLenum mode) {
+
+        glPolygonMode(face, mode);
+    }
+
+    void GLRenderBackend::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+
+        glDrawArrays(mode, first, count);
+    }
+
+    void GLRenderBackend::DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) {
+
+        glDrawElements(mode, count, type, offset);
+    }
+
+    void GLRenderBackend::DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) {
+
+        glDrawElementsInstanced(mode, count, type, offset, instanceCount);
+    }
+
+    void GLRenderBackend::GenQueries(GLsizei count, GLuint* queries) {
+
+        glGenQueries(count, queries);
+    }
+
+    void GLRenderBackend::DeleteQueries(GLsizei count, const GLuint* queries) {
+
+        glDeleteQueries(count, queries);
+    }
+
+    void GLRenderBackend::BeginQuery(GLenum target, GLuint query) {
+
+        glBeginQuery(target, query);
+    }
+
+    void GLRenderBackend::EndQuery(GLenum target) {
+
+        glEndQuery(target);
+    }
+
+    void GLRenderBackend::QueryCounter(GLuint query, GLenum target) {
+
+        glQueryCounter(query, target);
+    }
+
+    void GLRenderBackend::GetQueryObjectiv(GLuint query, GLenum name, GLint* value) {
+
+        glGetQueryObjectiv(query, name, value);
+    }
+
+    void GLRenderBackend::GetQueryObjectui64v(GLuint query, GLenum name, GLuint64* value) {
+
+        glGetQueryObjectui64v(query, name, value);
+    }
+
+    GLsync GLRenderBackend::FenceSync(GLenum condition, GLbitfield flags) {
+
+        return glFenceSync(condition, flags);
+    }
+
+    GLenum GLRenderBackend::ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+
+        return glClientWaitSync(sync, flags, timeout);
+    }
+
+    void GLRenderBackend::DeleteSync(GLsync sync) {
+
+        glDeleteSync(sync);
+    }
+
+    void GLRenderBackend::GetIntegerv(GLenum name, GLint* value) {
+
+        glGetIntegerv(name, value);
+    }
+
+    const GLubyte* GLRenderBackend::GetString(GLenum name) {
+
+        return glGetString(name);
+    }
+
+    GLenum GLRenderBackend::GetError() {
+
+        return glGetError();
+    }
+}
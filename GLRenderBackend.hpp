@@ -0,0 +1,115 @@
+#ifndef GLRenderBackend_hpp
+#define GLRenderBackend_hpp
+
+#include "RenderBackend.hpp"
+
+namespace gps {
+
+    // Hands every command straight to the OpenGL context current on this thread.
+    class GLRenderBackend : public RenderBackend {
+
+    public:
+        // shaders and programs
+        GLuint CreateShader(GLenum type) override;
+        void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) override;
+        void CompileShader(GLuint shader) override;
+        void GetShaderiv(GLuint shader, GLenum name, GLint* value) override;
+        void GetShaderInfoLog(GLuint shader, GLsizei size, GLsizei* length, GLchar* log) override;
+        void DeleteShader(GLuint shader) override;
+        GLuint CreateProgram() override;
+        void AttachShader(GLuint program, GLuint shader) override;
+        void LinkProgram(GLuint program) override;
+        void ProgramParameteri(GLuint program, GLenum name, GLint value) override;
+        void GetProgramiv(GLuint program, GLenum name, GLint* value) override;
+        void GetProgramInfoLog(GLuint program, GLsizei size, GLsizei* length, GLchar* log) override;
+        void ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length) override;
+        void GetProgramBinary(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary) override;
+        void DeleteProgram(GLuint program) override;
+        void UseProgram(GLuint program) override;
+
+        // uniforms of the program in use
+        GLint GetUniformLocation(GLuint program, const GLchar* name) override;
+        void Uniform1i(GLint location, GLint value) override;
+        void Uniform1f(GLint location, GLfloat value) override;
+        void Uniform2f(GLint location, GLfloat x, GLfloat y) override;
+        void Uniform3fv(GLint location, GLsizei count, const GLfloat* values) override;
+        void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) override;
+        void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) override;
+
+        // vertex arrays and buffers
+        void GenVertexArrays(GLsizei count, GLuint* arrays) override;
+        void DeleteVertexArrays(GLsizei count, const GLuint* arrays) override;
+        void BindVertexArray(GLuint array) override;
+        void GenBuffers(GLsizei count, GLuint* buffers) override;
+        void DeleteBuffers(GLsizei count, const GLuint* buffers) override;
+        void BindBuffer(GLenum target, GLuint buffer) override;
+        void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+        void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+        void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) override;
+        GLboolean UnmapBuffer(GLenum target) override;
+        void EnableVertexAttribArray(GLuint index) override;
+        void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset) override;
+        void VertexAttribDivisor(GLuint index, GLuint divisor) override;
+
+        // textures
+        void GenTextures(GLsizei count, GLuint* textures) override;
+        void DeleteTextures(GLsizei count, const GLuint* textures) override;
+        void ActiveTexture(GLenum unit) override;
+        void BindTexture(GLenum target, GLuint texture) override;
+        void TexParameteri(GLenum target, GLenum name, GLint value) override;
+        void TexParameteriv(GLenum target, GLenum name, const GLint* values) override;
+        void TexParameterfv(GLenum target, GLenum name, const GLfloat* values) override;
+        void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* data) override;
+        void CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei size, const void* data) override;
+        void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data) override;
+        void CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei size, const void* data) override;
+        void GenerateMipmap(GLenum target) override;
+        void TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) override;
+        void PixelStorei(GLenum name, GLint value) override;
+
+        // framebuffers
+        void GenFramebuffers(GLsizei count, GLuint* framebuffers) override;
+        void BindFramebuffer(GLenum target, GLuint framebuffer) override;
+        void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) override;
+        void DrawBuffer(GLenum buffer) override;
+        void ReadBuffer(GLenum buffer) override;
+
+        // fixed function state
+        void Enable(GLenum capability) override;
+        void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) override;
+        void Clear(GLbitfield mask) override;
+        void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+        void DepthFunc(GLenum func) override;
+        void DepthMask(GLboolean flag) override;
+        void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) override;
+        void CullFace(GLenum mode) override;
+        void FrontFace(GLenum mode) override;
+        void PolygonMode(GLenum face, GLenum mode) override;
+
+        // draws
+        void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+        void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) override;
+        void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) override;
+
+        // queries
+        void GenQueries(GLsizei count, GLuint* queries) override;
+        void DeleteQueries(GLsizei count, const GLuint* queries) override;
+        void BeginQuery(GLenum target, GLuint query) override;
+        void EndQuery(GLenum target) override;
+        void QueryCounter(GLuint query, GLenum target) override;
+        void GetQueryObjectiv(GLuint query, GLenum name, GLint* value) override;
+        void GetQueryObjectui64v(GLuint query, GLenum name, GLuint64* value) override;
+
+        // fences
+        GLsync FenceSync(GLenum condition, GLbitfield flags) override;
+        GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) override;
+        void DeleteSync(GLsync sync) override;
+
+        // context
+        void GetIntegerv(GLenum name, GLint* value) override;
+        const GLubyte* GetString(GLenum name) override;
+        GLenum GetError() override;
+    };
+}
+
+#endif /* GLRenderBackend_hpp */
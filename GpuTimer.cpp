@@ -0,0 +1,102 @@
+#include "GpuTimer.hpp"
+#include "RenderBackend.hpp"
+
+namespace gps {
+
+    void GpuTimer::Create() {
+
+        RenderBackend::getCurrent().GenQueries(QUERY_COUNT, queries);
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            pending[i] = false;
+            discarded[i] = false;
+        }
+        current = 0;
+        Reset();
+    }
+
+    void GpuTimer::Delete() {
+
+        RenderBackend::getCurrent().DeleteQueries(QUERY_COUNT, queries);
+    }
+
+    void GpuTimer::Begin() {
+
+        Collect();
+
+        // all queries still in flight, drop this sample instead of waiting for the GPU
+        if (pending[current]) {
+            return;
+        }
+
+        RenderBackend::getCurrent().BeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    void GpuTimer::End() {
+
+        if (pending[current]) {
+            return;
+        }
+
+        RenderBackend::getCurrent().EndQuery(GL_TIME_ELAPSED);
+        pending[current] = true;
+        current = (current + 1) % QUERY_COUNT;
+    }
+
+    void GpuTimer::Collect() {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        for (int i = 0; i < QUERY_COUNT; i++) {
+
+            if (!pending[i]) {
+                continue;
+            }
+
+            GLint available = 0;
+            backend.GetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                continue;
+            }
+
+            GLuint64 elapsed = 0;
+            backend.GetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+            pending[i] = false;
+
+            if (discarded[i]) {
+                discarded[i] = false;
+                continue;
+            }
+
+            lastMs = elapsed / 1000000.0;
+            totalMs += lastMs;
+            samples++;
+        }
+    }
+
+    double GpuTimer::getAverageMs() {
+
+        Collect();
+        return samples > 0 ? totalMs / samples : 0.0;
+    }
+
+    double GpuTimer::getLastMs() {
+
+        Collect();
+        return lastMs;
+    }
+
+    int GpuTimer::getSampleCount() {
+
+        return samples;
+    }
+
+    void GpuTimer::Reset() {
+
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            discarded[i] = pending[i];
+        }
+
+        lastMs = 0.0;
+        totalMs = 0.0;
+        samples = 0;
+    }
+}
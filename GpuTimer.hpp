@@ -0,0 +1,49 @@
+#ifndef GpuTimer_hpp
+#define GpuTimer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+namespace gps {
+
+    // Measures GPU time spent between Begin() and End() with GL_TIME_ELAPSED queries.
+    // Results are read back a few frames later so timing never stalls the pipeline.
+    class GpuTimer {
+
+    public:
+        void Create();
+        void Delete();
+
+        void Begin();
+        void End();
+
+        // average time in milliseconds of the samples collected since the last Reset()
+        double getAverageMs();
+        double getLastMs();
+        int getSampleCount();
+        void Reset();
+
+    private:
+        static const int QUERY_COUNT = 4;
+
+        GLuint queries[QUERY_COUNT];
+        bool pending[QUERY_COUNT];
+        // in flight when Reset() was called, read back but not counted
+        bool discarded[QUERY_COUNT];
+        int current = 0;
+
+        double lastMs = 0.0;
+        double totalMs = 0.0;
+        int samples = 0;
+
+        // reads back every finished query without waiting for the others
+        void Collect();
+    };
+}
+
+#endif /* GpuTimer_hpp */
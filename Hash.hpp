@@ -0,0 +1,29 @@
+#ifndef Hash_hpp
+#define Hash_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gps {
+
+    const uint64_t HASH_SEED = 14695981039346656037ull;
+
+    // 64 bit FNV-1a, stable across runs and compilers unlike std::hash, used for cache keys
+    inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = HASH_SEED) {
+
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    inline uint64_t hashString(const std::string& text, uint64_t hash = HASH_SEED) {
+
+        return hashBytes(text.data(), text.size(), hash);
+    }
+}
+
+#endif /* Hash_hpp */
@@ -0,0 +1,212 @@
+#include "InputLog.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+namespace gps {
+
+    namespace {
+
+        const char MAGIC[8] = { 'G', 'P', 'S', 'I', 'N', 'P', 'U', 'T' };
+    }
+
+    template <typename T>
+    void InputLog::put(T value) {
+
+        recording.write((const char*)&value, sizeof(T));
+        bytes += sizeof(T);
+    }
+
+    template <typename T>
+    bool InputLog::get(size_t& offset, T& value) {
+
+        if (offset + sizeof(T) > replay.size()) {
+            return false;
+        }
+        memcpy(&value, &replay[offset], sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool InputLog::OpenRecording(const std::string& fileName) {
+
+        Close();
+
+        recording.open(fileName, std::ios::binary);
+        if (!recording) {
+            return false;
+        }
+        recording.write(MAGIC, sizeof(MAGIC));
+        bytes = sizeof(MAGIC);
+        put<uint32_t>(VERSION);
+        return true;
+    }
+
+    bool InputLog::OpenReplay(const std::string& fileName) {
+
+        Close();
+
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        replay.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        size_t offset = sizeof(MAGIC);
+        uint32_t version = 0;
+        if (replay.size() < offset || memcmp(replay.data(), MAGIC, sizeof(MAGIC)) != 0 || !get(offset, version) || version != VERSION) {
+            replay.clear();
+            return false;
+        }
+
+        //counted up front so the frames can be timed, a truncated record ends the log
+        cursor = offset;
+        InputEvent event;
+        double time;
+        while (ReadRecord(offset, event, time)) {
+            if (event.type == INPUT_FRAME) {
+                frameCount++;
+            }
+        }
+        replay.resize(offset);
+        bytes = replay.size();
+        replaying = true;
+        return true;
+    }
+
+    void InputLog::Close() {
+
+        if (recording.is_open()) {
+            recording.close();
+        }
+        replay.clear();
+        cursor = 0;
+        replaying = false;
+        frameCount = 0;
+        bytes = 0;
+    }
+
+    void InputLog::WriteFrame(double time) {
+
+        put<uint8_t>(INPUT_FRAME);
+        put<double>(time);
+        frameCount++;
+    }
+
+    void InputLog::Write(const InputEvent& event) {
+
+        put<uint8_t>((uint8_t)event.type);
+        switch (event.type) {
+        case INPUT_KEY:
+            put<int16_t>((int16_t)event.code);
+            put<int32_t>(event.scancode);
+            put<uint8_t>((uint8_t)event.action);
+            put<uint8_t>((uint8_t)event.mods);
+            break;
+        case INPUT_MOUSE_BUTTON:
+            put<uint8_t>((uint8_t)event.code);
+            put<uint8_t>((uint8_t)event.action);
+            put<uint8_t>((uint8_t)event.mods);
+            break;
+        case INPUT_CURSOR:
+        case INPUT_SCROLL:
+            put<double>(event.x);
+            put<double>(event.y);
+            break;
+        case INPUT_FRAME:
+            break;
+        }
+    }
+
+    bool InputLog::ReadRecord(size_t& offset, InputEvent& event, double& time) {
+
+        size_t start = offset;
+        uint8_t type = 0;
+        if (!get(offset, type)) {
+            return false;
+        }
+
+        event.type = (INPUT_EVENT_TYPE)type;
+        event.code = 0;
+        event.scancode = 0;
+        event.action = 0;
+        event.mods = 0;
+        event.x = 0.0;
+        event.y = 0.0;
+
+        bool complete = false;
+        int16_t key = 0;
+        int32_t scancode = 0;
+        uint8_t code = 0, action = 0, mods = 0;
+        switch (event.type) {
+        case INPUT_FRAME:
+            complete = get(offset, time);
+            break;
+        case INPUT_KEY:
+            complete = get(offset, key) && get(offset, scancode) && get(offset, action) && get(offset, mods);
+            event.code = key;
+            event.scancode = scancode;
+            event.action = action;
+            event.mods = mods;
+            break;
+        case INPUT_MOUSE_BUTTON:
+            complete = get(offset, code) && get(offset, action) && get(offset, mods);
+            event.code = code;
+            event.action = action;
+            event.mods = mods;
+            break;
+        case INPUT_CURSOR:
+        case INPUT_SCROLL:
+            complete = get(offset, event.x) && get(offset, event.y);
+            break;
+        }
+
+        if (!complete) {
+            offset = start;
+        }
+        return complete;
+    }
+
+    bool InputLog::NextFrame(double& time) {
+
+        InputEvent event;
+        while (ReadRecord(cursor, event, time)) {
+            if (event.type == INPUT_FRAME) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool InputLog::NextEvent(InputEvent& event) {
+
+        size_t offset = cursor;
+        double time;
+        if (!ReadRecord(offset, event, time) || event.type == INPUT_FRAME) {
+            return false;
+        }
+        cursor = offset;
+        return true;
+    }
+
+    bool InputLog::isRecording() {
+
+        return recording.is_open();
+    }
+
+    bool InputLog::isReplaying() {
+
+        return replaying;
+    }
+
+    int InputLog::getFrameCount() {
+
+        return frameCount;
+    }
+
+    size_t InputLog::getBytes() {
+
+        return bytes;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef InputLog_hpp
+#define InputLog_hpp
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    enum INPUT_EVENT_TYPE {INPUT_FRAME, INPUT_KEY, INPUT_MOUSE_BUTTON, INPUT_CURSOR, INPUT_SCROLL};
+
+    // one GLFW callback, with the arguments it was called with
+    struct InputEvent {
+        INPUT_EVENT_TYPE type;
+        // key or mouse button
+        int code;
+        int scancode;
+        int action;
+        int mods;
+        // cursor position or scroll offsets
+        double x;
+        double y;
+    };
+
+    // Input events of a session in a compact binary file, to play it again frame by frame.
+    // The file is "GPSINPUT", a version and then records of a type byte and its fields in host byte order:
+    // a frame holds the simulation time it started at, the events after it arrived during that frame.
+    // Replayed at the same frame times, the events reach the scene in the same state as when recorded.
+    class InputLog {
+
+    public:
+        static const unsigned int VERSION = 1;
+
+        // false when the file cannot be created
+        bool OpenRecording(const std::string& fileName);
+        // reads the whole log, false when it is missing or not an input log
+        bool OpenReplay(const std::string& fileName);
+        void Close();
+
+        // the time of the frame about to run, then every event it receives
+        void WriteFrame(double time);
+        void Write(const InputEvent& event);
+
+        // moves to the next frame, skipping the events left in this one, false after the last one
+        bool NextFrame(double& time);
+        // the events of the current frame in the order they arrived, false when there are no more
+        bool NextEvent(InputEvent& event);
+
+        bool isRecording();
+        bool isReplaying();
+        // frames written so far, or in the whole log when replaying
+        int getFrameCount();
+        size_t getBytes();
+
+    private:
+        std::ofstream recording;
+        // the log being replayed and the read position in it
+        std::vector<unsigned char> replay;
+        size_t cursor = 0;
+        bool replaying = false;
+        int frameCount = 0;
+        size_t bytes = 0;
+
+        template <typename T>
+        void put(T value);
+        template <typename T>
+        bool get(size_t& offset, T& value);
+        // decodes the record at offset and moves past it, false at the end or on a truncated record
+        bool ReadRecord(size_t& offset, InputEvent& event, double& time);
+    };
+}
+
+#endif /* InputLog_hpp */
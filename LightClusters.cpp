@@ -0,0 +1,254 @@
+#include "LightClusters.hpp"
+#include "RenderBackend.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace gps {
+
+    namespace {
+
+        double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        bool sphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+
+            //squared distance from the center to the closest point of the box
+            float distance = 0.0f;
+            for (int i = 0; i < 3; i++) {
+                float v = center[i];
+                if (v < boxMin[i])
+                    distance += (boxMin[i] - v) * (boxMin[i] - v);
+                else if (v > boxMax[i])
+                    distance += (v - boxMax[i]) * (v - boxMax[i]);
+            }
+            return distance <= radius * radius;
+        }
+    }
+
+    void LightClusters::Create() {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.GenBuffers(1, &lightBuffer);
+        backend.GenBuffers(1, &gridBuffer);
+        backend.GenBuffers(1, &indexBuffer);
+        backend.GenTextures(1, &lightTexture);
+        backend.GenTextures(1, &gridTexture);
+        backend.GenTextures(1, &indexTexture);
+
+        grid.assign(CLUSTER_COUNT * 2, 0);
+        sliceIndices.resize(GRID_Z);
+
+        //a texture buffer needs a store before it can be sampled, start with no lights
+        lightData.assign(2, glm::vec4(0.0f));
+        indices.assign(1, 0);
+        Upload(lightBuffer, lightTexture, GL_RGBA32F, lightData.data(), lightData.size() * sizeof(glm::vec4));
+        Upload(gridBuffer, gridTexture, GL_RG32UI, grid.data(), grid.size() * sizeof(GLuint));
+        Upload(indexBuffer, indexTexture, GL_R32UI, indices.data(), indices.size() * sizeof(GLuint));
+    }
+
+    void LightClusters::Delete() {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.DeleteTextures(1, &lightTexture);
+        backend.DeleteTextures(1, &gridTexture);
+        backend.DeleteTextures(1, &indexTexture);
+        backend.DeleteBuffers(1, &lightBuffer);
+        backend.DeleteBuffers(1, &gridBuffer);
+        backend.DeleteBuffers(1, &indexBuffer);
+    }
+
+    void LightClusters::setProjection(float fovYDegrees, float aspect, float nearPlane, float farPlane) {
+
+        if (fovYDegrees == this->fovY && aspect == this->aspect && nearPlane == this->nearPlane && farPlane == this->farPlane) {
+            return;
+        }
+
+        this->fovY = fovYDegrees;
+        this->aspect = aspect;
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+
+        clusterMin.resize(CLUSTER_COUNT);
+        clusterMax.resize(CLUSTER_COUNT);
+
+        float tanY = std::tan(glm::radians(fovYDegrees) * 0.5f);
+        float tanX = tanY * aspect;
+
+        for (int z = 0; z < GRID_Z; z++) {
+
+            //exponential slices, same formula as basic.frag uses to find its slice
+            float sliceNear = nearPlane * std::pow(farPlane / nearPlane, (float)z / GRID_Z);
+            float sliceFar = nearPlane * std::pow(farPlane / nearPlane, (float)(z + 1) / GRID_Z);
+
+            for (int y = 0; y < GRID_Y; y++) {
+                for (int x = 0; x < GRID_X; x++) {
+
+                    float ndcX0 = -1.0f + 2.0f * x / GRID_X;
+                    float ndcX1 = -1.0f + 2.0f * (x + 1) / GRID_X;
+                    float ndcY0 = -1.0f + 2.0f * y / GRID_Y;
+                    float ndcY1 = -1.0f + 2.0f * (y + 1) / GRID_Y;
+
+                    //the tile corners at both slice depths, the camera looks down -z
+                    glm::vec3 boxMin(1e30f);
+                    glm::vec3 boxMax(-1e30f);
+                    float depths[2] = { sliceNear, sliceFar };
+                    float ndcXs[2] = { ndcX0, ndcX1 };
+                    float ndcYs[2] = { ndcY0, ndcY1 };
+                    for (int d = 0; d < 2; d++) {
+                        for (int i = 0; i < 2; i++) {
+                            for (int j = 0; j < 2; j++) {
+                                glm::vec3 corner(ndcXs[i] * tanX * depths[d], ndcYs[j] * tanY * depths[d], -depths[d]);
+                                boxMin = glm::min(boxMin, corner);
+                                boxMax = glm::max(boxMax, corner);
+                            }
+                        }
+                    }
+
+                    int cluster = (z * GRID_Y + y) * GRID_X + x;
+                    clusterMin[cluster] = boxMin;
+                    clusterMax[cluster] = boxMax;
+                }
+            }
+        }
+    }
+
+    void LightClusters::AssignSlice(int slice, const std::vector<glm::vec4>& viewLights) {
+
+        std::vector<GLuint>& list = sliceIndices[slice];
+        list.clear();
+
+        int first = slice * GRID_X * GRID_Y;
+        float sliceNear = -clusterMax[first].z;
+        float sliceFar = -clusterMin[first].z;
+
+        //only the lights overlapping this depth range are tested against its tiles
+        std::vector<GLuint> candidates;
+        for (size_t i = 0; i < viewLights.size(); i++) {
+            float depth = -viewLights[i].z;
+            float radius = viewLights[i].w;
+            if (depth + radius >= sliceNear && depth - radius <= sliceFar) {
+                candidates.push_back((GLuint)i);
+            }
+        }
+
+        for (int tile = 0; tile < GRID_X * GRID_Y; tile++) {
+
+            int cluster = first + tile;
+            //offset is relative to the slice for now, made global when merging
+            grid[cluster * 2] = (GLuint)list.size();
+
+            for (size_t c = 0; c < candidates.size(); c++) {
+                const glm::vec4& light = viewLights[candidates[c]];
+                if (sphereIntersectsBox(glm::vec3(light), light.w, clusterMin[cluster], clusterMax[cluster])) {
+                    list.push_back(candidates[c]);
+                }
+            }
+
+            grid[cluster * 2 + 1] = (GLuint)list.size() - grid[cluster * 2];
+        }
+    }
+
+    void LightClusters::Update(const std::vector<PointLight>& lights, const glm::mat4& view) {
+
+        std::chrono::high_resolution_clock::time_point assignStart = std::chrono::high_resolution_clock::now();
+
+        lightCount = (int)lights.size();
+
+        //positions to view space once, the froxels live there
+        std::vector<glm::vec4> viewLights(lights.size());
+        lightData.resize(std::max((size_t)1, lights.size()) * 2);
+        for (size_t i = 0; i < lights.size(); i++) {
+            glm::vec4 position = view * glm::vec4(lights[i].position, 1.0f);
+            viewLights[i] = glm::vec4(position.x, position.y, position.z, lights[i].radius);
+            lightData[i * 2] = viewLights[i];
+            lightData[i * 2 + 1] = glm::vec4(lights[i].color * lights[i].intensity, 0.0f);
+        }
+
+        ThreadPool::getShared().ParallelFor(GRID_Z, [&](int begin, int end) {
+            for (int slice = begin; slice < end; slice++) {
+                AssignSlice(slice, viewLights);
+            }
+        });
+
+        //concatenate the slice lists and turn the offsets global
+        indices.clear();
+        for (int slice = 0; slice < GRID_Z; slice++) {
+            GLuint base = (GLuint)indices.size();
+            for (int tile = 0; tile < GRID_X * GRID_Y; tile++) {
+                grid[(slice * GRID_X * GRID_Y + tile) * 2] += base;
+            }
+            indices.insert(indices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+        }
+        if (indices.empty()) {
+            indices.push_back(0);
+        }
+
+        assignMs = millisecondsSince(assignStart);
+
+        std::chrono::high_resolution_clock::time_point uploadStart = std::chrono::high_resolution_clock::now();
+        Upload(lightBuffer, lightTexture, GL_RGBA32F, lightData.data(), lightData.size() * sizeof(glm::vec4));
+        Upload(gridBuffer, gridTexture, GL_RG32UI, grid.data(), grid.size() * sizeof(GLuint));
+        Upload(indexBuffer, indexTexture, GL_R32UI, indices.data(), indices.size() * sizeof(GLuint));
+        uploadMs = millisecondsSince(uploadStart);
+    }
+
+    void LightClusters::Upload(GLuint buffer, GLuint texture, GLenum format, const void* data, size_t size) {
+
+        //orphan the previous store so the upload does not wait for last frame's draws
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.BindBuffer(GL_TEXTURE_BUFFER, buffer);
+        backend.BufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        backend.BufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        backend.BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        backend.BindTexture(GL_TEXTURE_BUFFER, texture);
+        backend.TexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        backend.BindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void LightClusters::Bind(GLuint firstUnit) {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.ActiveTexture(GL_TEXTURE0 + firstUnit);
+        backend.BindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        backend.ActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+        backend.BindTexture(GL_TEXTURE_BUFFER, gridTexture);
+        backend.ActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+        backend.BindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    }
+
+    float LightClusters::getNearPlane() {
+
+        return nearPlane;
+    }
+
+    float LightClusters::getFarPlane() {
+
+        return farPlane;
+    }
+
+    double LightClusters::getAssignMs() {
+
+        return assignMs;
+    }
+
+    double LightClusters::getUploadMs() {
+
+        return uploadMs;
+    }
+
+    int LightClusters::getLightCount() {
+
+        return lightCount;
+    }
+
+    int LightClusters::getIndexCount() {
+
+        return (int)indices.size();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef LightClusters_hpp
+#define LightClusters_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    struct PointLight {
+
+        glm::vec3 position;
+        // no contribution past this distance
+        float radius;
+        glm::vec3 color;
+        float intensity;
+    };
+
+    // Clustered forward lighting: the view frustum is cut into a grid of froxels (screen tiles
+    // times exponential depth slices) and every froxel gets the list of point lights touching it.
+    // basic.frag (CLUSTERED) then only loops over the lights of its own froxel.
+    // Lists are built on the CPU each frame and read through texture buffers, GL 4.1 has no SSBOs.
+    class LightClusters {
+
+    public:
+        static const int GRID_X = 16;
+        static const int GRID_Y = 9;
+        static const int GRID_Z = 24;
+        static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+        void Create();
+        void Delete();
+
+        // recomputes the froxel bounds, cheap to call every frame when nothing changed
+        void setProjection(float fovYDegrees, float aspect, float nearPlane, float farPlane);
+
+        // assigns the world space lights to froxels on the thread pool and uploads the lists
+        void Update(const std::vector<PointLight>& lights, const glm::mat4& view);
+
+        // binds lights, grid and index list to three consecutive texture units starting at firstUnit
+        void Bind(GLuint firstUnit);
+
+        float getNearPlane();
+        float getFarPlane();
+
+        // CPU timings of the last Update()
+        double getAssignMs();
+        double getUploadMs();
+        int getLightCount();
+        int getIndexCount();
+
+    private:
+        // view space bounds of every froxel
+        std::vector<glm::vec3> clusterMin;
+        std::vector<glm::vec3> clusterMax;
+
+        float fovY = 0.0f;
+        float aspect = 0.0f;
+        float nearPlane = 0.0f;
+        float farPlane = 0.0f;
+
+        // two RGBA32F texels per light: view position + radius, color * intensity
+        std::vector<glm::vec4> lightData;
+        // offset and count into the index list per froxel
+        std::vector<GLuint> grid;
+        std::vector<GLuint> indices;
+        // per depth slice lists, merged into indices after the parallel pass
+        std::vector<std::vector<GLuint> > sliceIndices;
+
+        GLuint lightBuffer;
+        GLuint lightTexture;
+        GLuint gridBuffer;
+        GLuint gridTexture;
+        GLuint indexBuffer;
+        GLuint indexTexture;
+
+        int lightCount = 0;
+        double assignMs = 0.0;
+        double uploadMs = 0.0;
+
+        void AssignSlice(int slice, const std::vector<glm::vec4>& viewLights);
+        void Upload(GLuint buffer, GLuint texture, GLenum format, const void* data, size_t size);
+    };
+}
+
+#endif /* LightClusters_hpp */
@@ -0,0 +1,358 @@
+#include "MaterialTextures.hpp"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace gps {
+
+    namespace {
+
+        // uvec4 diffuse, uvec4 specular, std140 keeps them tightly packed
+        const int MATERIAL_WORDS = 8;
+        // array index of a material without that texture
+        const GLuint NO_ARRAY = 0xFFFFFFFFu;
+
+        GLuint findTexture(const Mesh& mesh, const std::string& type) {
+
+            for (size_t i = 0; i < mesh.textures.size(); i++) {
+                if (mesh.textures[i].type == type)
+                    return mesh.textures[i].id;
+            }
+            return 0;
+        }
+    }
+
+    MaterialMode MaterialTextures::Create(const std::vector<Model3D*>& models, bool allowBindless) {
+
+        Delete();
+
+        std::vector<Mesh*> meshes;
+        for (size_t i = 0; i < models.size(); i++) {
+            std::vector<Mesh>& modelMeshes = models[i]->getMeshes();
+            for (size_t j = 0; j < modelMeshes.size(); j++)
+                meshes.push_back(&modelMeshes[j]);
+        }
+
+        std::vector<GLuint> textures;
+        for (size_t i = 0; i < meshes.size(); i++) {
+            for (size_t j = 0; j < meshes[i]->textures.size(); j++) {
+                if (meshes[i]->textures[j].id != 0)
+                    textures.push_back(meshes[i]->textures[j].id);
+            }
+        }
+        std::sort(textures.begin(), textures.end());
+        textures.erase(std::unique(textures.begin(), textures.end()), textures.end());
+
+        //where every texture ended up, missing ones cannot be used through a material
+        std::unordered_map<GLuint, Slot> placed;
+
+#if not defined (__APPLE__)
+        if (allowBindless && GLEW_ARB_bindless_texture) {
+
+            mode = MATERIALS_BINDLESS;
+            for (size_t i = 0; i < textures.size(); i++) {
+                //the texture state is frozen from here on
+                GLuint64 handle = glGetTextureHandleARB(textures[i]);
+                if (handle == 0)
+                    continue;
+                glMakeTextureHandleResidentARB(handle);
+                residentHandles.push_back(handle);
+
+                Slot slot = { NO_ARRAY, 0, handle };
+                placed[textures[i]] = slot;
+            }
+        }
+#endif
+
+        if (mode == MATERIALS_OFF) {
+
+            mode = MATERIALS_ARRAYS;
+
+            //textures are grouped when an array could hold them all
+            std::vector<TextureGroup> groups;
+            std::unordered_map<GLuint, size_t> groupOf;
+            for (size_t i = 0; i < textures.size(); i++) {
+                TextureGroup texture;
+                if (!describeTexture(textures[i], texture))
+                    continue;
+
+                size_t group = 0;
+                while (group < groups.size() && !sameGroup(groups[group], texture))
+                    group++;
+                if (group == groups.size()) {
+                    texture.uses = 0;
+                    groups.push_back(texture);
+                }
+                groups[group].textures.push_back(textures[i]);
+                groupOf[textures[i]] = group;
+            }
+
+            for (size_t i = 0; i < meshes.size(); i++) {
+                for (size_t j = 0; j < meshes[i]->textures.size(); j++) {
+                    std::unordered_map<GLuint, size_t>::iterator found = groupOf.find(meshes[i]->textures[j].id);
+                    if (found != groupOf.end())
+                        groups[found->second].uses++;
+                }
+            }
+
+            //the units are limited, the groups saving the most binds get them
+            std::vector<size_t> order(groups.size());
+            for (size_t i = 0; i < order.size(); i++)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [&groups](size_t a, size_t b) { return groups[a].uses > groups[b].uses; });
+
+            for (size_t i = 0; i < order.size() && arrays.size() < (size_t)MAX_ARRAYS; i++) {
+                const TextureGroup& group = groups[order[i]];
+                GLuint array = BuildArray(group);
+                if (array == 0)
+                    continue;
+
+                for (size_t layer = 0; layer < group.textures.size(); layer++) {
+                    Slot slot = { (GLuint)arrays.size(), (GLuint)layer, 0 };
+                    placed[group.textures[layer]] = slot;
+                }
+                arrays.push_back(array);
+            }
+        }
+
+        //one material per texture pair, meshes with a texture left out keep binding their own
+        std::vector<Slot> slots;
+        std::map<std::pair<GLuint, GLuint>, int> materials;
+        std::vector<GLuint> boundTextures;
+        unassignedCount = 0;
+        for (size_t i = 0; i < meshes.size(); i++) {
+
+            Mesh& mesh = *meshes[i];
+            mesh.materialIndex = -1;
+
+            bool complete = true;
+            for (size_t j = 0; j < mesh.textures.size(); j++) {
+                if (mesh.textures[j].id != 0 && placed.find(mesh.textures[j].id) == placed.end())
+                    complete = false;
+            }
+
+            std::pair<GLuint, GLuint> key(findTexture(mesh, "diffuseTexture"), findTexture(mesh, "specularTexture"));
+            std::map<std::pair<GLuint, GLuint>, int>::iterator found = materials.find(key);
+            if (complete && found == materials.end() && (int)materials.size() < MAX_MATERIALS) {
+
+                Slot none = { NO_ARRAY, 0, 0 };
+                found = materials.insert(std::make_pair(key, (int)materials.size())).first;
+                slots.push_back(key.first != 0 ? placed[key.first] : none);
+                slots.push_back(key.second != 0 ? placed[key.second] : none);
+            }
+
+            if (complete && found != materials.end()) {
+                mesh.materialIndex = found->second;
+            }
+            else {
+                unassignedCount++;
+                for (size_t j = 0; j < mesh.textures.size(); j++)
+                    boundTextures.push_back(mesh.textures[j].id);
+            }
+        }
+        materialCount = (int)materials.size();
+
+        //array layers are copies, the originals only stay for the meshes still binding them
+        if (mode == MATERIALS_ARRAYS) {
+            std::vector<GLuint> copied;
+            for (std::unordered_map<GLuint, Slot>::iterator it = placed.begin(); it != placed.end(); ++it) {
+                if (std::find(boundTextures.begin(), boundTextures.end(), it->first) == boundTextures.end())
+                    copied.push_back(it->first);
+            }
+            for (size_t i = 0; i < models.size(); i++)
+                models[i]->ReleaseTextures(copied);
+        }
+
+        Upload(slots);
+
+        return mode;
+    }
+
+    void MaterialTextures::Delete() {
+
+#if not defined (__APPLE__)
+        for (size_t i = 0; i < residentHandles.size(); i++)
+            glMakeTextureHandleNonResidentARB(residentHandles[i]);
+#endif
+        residentHandles.clear();
+
+        if (!arrays.empty())
+            glDeleteTextures((GLsizei)arrays.size(), arrays.data());
+        arrays.clear();
+
+        if (buffer != 0)
+            glDeleteBuffers(1, &buffer);
+        buffer = 0;
+
+        mode = MATERIALS_OFF;
+        materialCount = 0;
+        unassignedCount = 0;
+    }
+
+    std::string MaterialTextures::getShaderDefines() {
+
+        std::string defines = "#define MAX_MATERIALS " + std::to_string(MAX_MATERIALS) + "\n";
+        if (mode == MATERIALS_ARRAYS)
+            return defines + "#define MATERIAL_ARRAYS\n#define MATERIAL_ARRAY_COUNT " + std::to_string(std::max<size_t>(1, arrays.size())) + "\n";
+        if (mode == MATERIALS_BINDLESS)
+            return defines + "#define MATERIAL_BINDLESS\n";
+
+        return "";
+    }
+
+    void MaterialTextures::applyUniforms(GLuint program, GLuint firstUnit) {
+
+        if (mode == MATERIALS_OFF) {
+            return;
+        }
+
+        GLuint block = glGetUniformBlockIndex(program, "Materials");
+        if (block != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, block, BINDING);
+        }
+
+        if (!arrays.empty()) {
+            GLint units[MAX_ARRAYS];
+            for (size_t i = 0; i < arrays.size(); i++)
+                units[i] = (GLint)(firstUnit + i);
+            glUniform1iv(glGetUniformLocation(program, "materialArrays"), (GLsizei)arrays.size(), units);
+        }
+    }
+
+    void MaterialTextures::Bind(GLuint firstUnit) {
+
+        if (mode == MATERIALS_OFF) {
+            return;
+        }
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+        for (size_t i = 0; i < arrays.size(); i++) {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + (GLuint)i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    MaterialMode MaterialTextures::getMode() {
+
+        return mode;
+    }
+
+    int MaterialTextures::getMaterialCount() {
+
+        return materialCount;
+    }
+
+    int MaterialTextures::getArrayCount() {
+
+        return (int)arrays.size();
+    }
+
+    int MaterialTextures::getUnassignedCount() {
+
+        return unassignedCount;
+    }
+
+    bool MaterialTextures::describeTexture(GLuint texture, TextureGroup& group) {
+
+        GLint compressed = GL_FALSE;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &group.width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &group.height);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &group.internalFormat);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, group.swizzle);
+        group.compressed = compressed == GL_TRUE;
+
+        //levels that were never specified report a width of 0
+        group.levels = 0;
+        GLint width = group.width;
+        while (width > 0 && group.levels < 32) {
+            group.levels++;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, group.levels, GL_TEXTURE_WIDTH, &width);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return group.width > 0 && group.height > 0;
+    }
+
+    bool MaterialTextures::sameGroup(const TextureGroup& a, const TextureGroup& b) {
+
+        return a.internalFormat == b.internalFormat && a.compressed == b.compressed && a.width == b.width && a.height == b.height &&
+            a.levels == b.levels && std::equal(a.swizzle, a.swizzle + 4, b.swizzle);
+    }
+
+    GLuint MaterialTextures::BuildArray(const TextureGroup& group) {
+
+        GLsizei layers = (GLsizei)group.textures.size();
+
+        GLuint array;
+        glGenTextures(1, &array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, group.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, group.levels - 1);
+        glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, group.swizzle);
+
+        //GL 4.1 has no glCopyImageSubData, the levels take a trip through client memory at load time
+        //uncompressed data is read back as RGBA8 whatever the format, stored values are never converted
+        std::vector<unsigned char> data;
+        for (int level = 0; level < group.levels; level++) {
+
+            GLsizei width = std::max(1, group.width >> level);
+            GLsizei height = std::max(1, group.height >> level);
+            GLint levelSize = width * height * 4;
+            if (group.compressed) {
+                glBindTexture(GL_TEXTURE_2D, group.textures[0]);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, group.internalFormat, width, height, layers, 0, levelSize * layers, NULL);
+            }
+            else {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, group.internalFormat, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            }
+
+            data.resize(levelSize);
+            for (GLsizei layer = 0; layer < layers; layer++) {
+
+                glBindTexture(GL_TEXTURE_2D, group.textures[layer]);
+                if (group.compressed) {
+                    glGetCompressedTexImage(GL_TEXTURE_2D, level, data.data());
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, group.internalFormat, levelSize, data.data());
+                }
+                else {
+                    glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+                }
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        return array;
+    }
+
+    void MaterialTextures::Upload(const std::vector<Slot>& slots) {
+
+        std::vector<GLuint> words(MATERIAL_WORDS * MAX_MATERIALS, 0);
+        for (size_t i = 0; i < slots.size(); i++) {
+            GLuint* slot = &words[i * 4];
+            if (mode == MATERIALS_BINDLESS) {
+                slot[0] = (GLuint)(slots[i].handle & 0xFFFFFFFFu);
+                slot[1] = (GLuint)(slots[i].handle >> 32);
+            }
+            else {
+                slot[0] = slots[i].array;
+                slot[1] = slots[i].layer;
+            }
+        }
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, words.size() * sizeof(GLuint), words.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
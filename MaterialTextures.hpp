@@ -0,0 +1,101 @@
+#ifndef MaterialTextures_hpp
+#define MaterialTextures_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Model3D.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    enum MaterialMode {
+        // meshes bind their own textures before every draw
+        MATERIALS_OFF,
+        // textures of the same size and format are layers of one GL_TEXTURE_2D_ARRAY
+        MATERIALS_ARRAYS,
+        // every texture is a resident ARB_bindless_texture handle
+        MATERIALS_BINDLESS
+    };
+
+    // Takes the per draw texture binds out of the scene pass.
+    // Every distinct (diffuse, specular) pair of the meshes becomes a material, an entry of a
+    // uniform buffer saying where its textures are. The arrays, or nothing at all with bindless
+    // handles, are bound once per frame and a mesh only sets its material index.
+    // The textures have to be complete when Create runs, so texture streaming is not used with it.
+    class MaterialTextures {
+
+    public:
+        // entries of the uniform buffer, also the size of the array in basic.frag
+        static const int MAX_MATERIALS = 256;
+        // texture units from the first one passed to Bind, the groups past it stay on per draw binds
+        static const int MAX_ARRAYS = 8;
+        // uniform buffer binding point of the Materials block
+        static const GLuint BINDING = 0;
+
+        // assigns the material indices of the meshes, bindless when allowed and supported
+        // the textures moved into arrays are released by the models
+        MaterialMode Create(const std::vector<Model3D*>& models, bool allowBindless);
+        void Delete();
+
+        // #defines basic.frag needs for the mode, see Shader::setDefines()
+        std::string getShaderDefines();
+
+        // once per program after selecting it: block binding and sampler units of the arrays
+        void applyUniforms(GLuint program, GLuint firstUnit);
+        // once per frame before the scene pass
+        void Bind(GLuint firstUnit);
+
+        MaterialMode getMode();
+        int getMaterialCount();
+        int getArrayCount();
+        // meshes left binding their own textures
+        int getUnassignedCount();
+
+    private:
+        // where one texture of a material is, see basic.frag
+        struct Slot {
+            GLuint array;
+            GLuint layer;
+            // bindless handle
+            uint64_t handle;
+        };
+
+        // textures that can share an array
+        struct TextureGroup {
+            GLint internalFormat;
+            bool compressed;
+            int width;
+            int height;
+            int levels;
+            GLint swizzle[4];
+            std::vector<GLuint> textures;
+            // draws that would stop binding if the group got an array
+            int uses;
+        };
+
+        MaterialMode mode = MATERIALS_OFF;
+        GLuint buffer = 0;
+        std::vector<GLuint> arrays;
+        std::vector<GLuint64> residentHandles;
+        int materialCount = 0;
+        int unassignedCount = 0;
+
+        // size, format and level count of a texture, false for a missing one
+        static bool describeTexture(GLuint texture, TextureGroup& group);
+        static bool sameGroup(const TextureGroup& a, const TextureGroup& b);
+        // copies the levels of every texture of the group into the layers of a new array
+        static GLuint BuildArray(const TextureGroup& group);
+        void Upload(const std::vector<Slot>& slots);
+    };
+}
+
+#endif /* MaterialTextures_hpp */
@@ -1,4 +1,8 @@
 #include "Mesh.hpp"
+#include "RenderBackend.hpp"
+
+#include <cmath>
+
 namespace gps {
 
 	/* Mesh Constructor */
@@ -7,8 +11,36 @@ namespace gps {
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
+		this->materialIndex = -1;
 
 		this->setupMesh();
+		this->computeBounds();
+	}
+
+	void Mesh::computeBounds() {
+
+		glm::vec3 minimum(0.0f);
+		glm::vec3 maximum(0.0f);
+		for (size_t i = 0; i < vertices.size(); i++) {
+			minimum = i == 0 ? vertices[i].Position : glm::min(minimum, vertices[i].Position);
+			maximum = i == 0 ? vertices[i].Position : glm::max(maximum, vertices[i].Position);
+		}
+		boundsCenter = (minimum + maximum) * 0.5f;
+		boundsRadius = glm::length(maximum - minimum) * 0.5f;
+
+		// sqrt of texture space area over model space area
+		float uvArea = 0.0f;
+		float area = 0.0f;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const Vertex& a = vertices[indices[i]];
+			const Vertex& b = vertices[indices[i + 1]];
+			const Vertex& c = vertices[indices[i + 2]];
+			area += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position)) * 0.5f;
+			glm::vec2 uvB = b.TexCoords - a.TexCoords;
+			glm::vec2 uvC = c.TexCoords - a.TexCoords;
+			uvArea += std::abs(uvB.x * uvC.y - uvB.y * uvC.x) * 0.5f;
+		}
+		uvDensity = area > 0.0f ? std::sqrt(uvArea / area) : 0.0f;
 	}
 
 
@@ -18,57 +50,111 @@ namespace gps {
 	}
 
 	/* Mesh drawing function - also applies associated textures */
-	void Mesh::Draw(gps::Shader shader)	{
+	void Mesh::Draw(gps::Shader& shader)	{
 
+		RenderBackend& backend = RenderBackend::getCurrent();
 		shader.useShaderProgram();
+		bindTextures(shader);
+
+		backend.BindVertexArray(this->buffers.VAO);
+		backend.DrawElements(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0);
+		backend.BindVertexArray(0);
+
+		unbindTextures();
+    }
+
+	void Mesh::DrawInstanced(gps::Shader& shader, GLsizei instanceCount) {
+
+		RenderBackend& backend = RenderBackend::getCurrent();
+		shader.useShaderProgram();
+		bindTextures(shader);
+
+		backend.BindVertexArray(this->buffers.VAO);
+		backend.DrawElementsInstanced(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
+		backend.BindVertexArray(0);
+
+		unbindTextures();
+	}
+
+	void Mesh::setInstanceBuffer(GLuint instanceVBO) {
+
+		RenderBackend& backend = RenderBackend::getCurrent();
+		backend.BindVertexArray(this->buffers.VAO);
+		backend.BindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+		// a mat4 attribute takes four consecutive locations, one per column
+		for (GLuint i = 0; i < 4; i++) {
+
+			backend.EnableVertexAttribArray(3 + i);
+			backend.VertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid*)(i * sizeof(glm::vec4)));
+			backend.VertexAttribDivisor(3 + i, 1);
+		}
+
+		backend.BindVertexArray(0);
+		backend.BindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void Mesh::bindTextures(gps::Shader& shader) {
+
+		RenderBackend& backend = RenderBackend::getCurrent();
+		//material textures are bound once per frame, the index picks them in the shader
+		//programs built without them, the depth passes among others, have no location
+		GLint materialIndexLocation = shader.getMaterialIndexLocation();
+		if (materialIndexLocation >= 0)
+			backend.Uniform1i(materialIndexLocation, materialIndex);
+		if (materialIndex >= 0)
+			return;
 
 		//set textures
 		for (GLuint i = 0; i < textures.size(); i++) {
 
-			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
+			backend.ActiveTexture(GL_TEXTURE0 + i);
+			backend.Uniform1i(backend.GetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
+			backend.BindTexture(GL_TEXTURE_2D, this->textures[i].id);
 		}
+	}
+
+	void Mesh::unbindTextures() {
 
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+        RenderBackend& backend = RenderBackend::getCurrent();
+        if (materialIndex >= 0)
+            return;
 
         for(GLuint i = 0; i < this->textures.size(); i++) {
 
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            backend.ActiveTexture(GL_TEXTURE0 + i);
+            backend.BindTexture(GL_TEXTURE_2D, 0);
         }
-
-    }
+	}
 
 	// Initializes all the buffer objects/arrays
 	void Mesh::setupMesh() {
 
+		RenderBackend& backend = RenderBackend::getCurrent();
 		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
-		glGenBuffers(1, &this->buffers.VBO);
-		glGenBuffers(1, &this->buffers.EBO);
+		backend.GenVertexArrays(1, &this->buffers.VAO);
+		backend.GenBuffers(1, &this->buffers.VBO);
+		backend.GenBuffers(1, &this->buffers.EBO);
 
-		glBindVertexArray(this->buffers.VAO);
+		backend.BindVertexArray(this->buffers.VAO);
 		// Load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+		backend.BindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
+		backend.BufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+		backend.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
+		backend.BufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
 
 		// Set the vertex attribute pointers
 		// Vertex Positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+		backend.EnableVertexAttribArray(0);
+		backend.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
 		// Vertex Normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+		backend.EnableVertexAttribArray(1);
+		backend.VertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
 		// Vertex Texture Coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+		backend.EnableVertexAttribArray(2);
+		backend.VertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
 
-		glBindVertexArray(0);
+		backend.BindVertexArray(0);
 	}
 }
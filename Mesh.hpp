@@ -54,11 +54,25 @@ namespace gps {
         std::vector<GLuint> indices;
         std::vector<Texture> textures;
 
+        // bounding sphere in model space
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+        // texture coordinate change per model space unit, averaged over the triangles
+        float uvDensity;
+        // entry of the material uniform buffer, -1 when the mesh binds its own textures
+        int materialIndex;
+
 	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
 
 	    Buffers getBuffers();
 
-	    void Draw(gps::Shader shader);
+	    void Draw(gps::Shader& shader);
+
+	    // Draws instanceCount copies, reading the model matrices from the instance buffer
+	    void DrawInstanced(gps::Shader& shader, GLsizei instanceCount);
+
+	    // Sources attributes 3-6 (one mat4 per instance) from the given buffer
+	    void setInstanceBuffer(GLuint instanceVBO);
 
     private:
         /*  Render data  */
@@ -67,6 +81,12 @@ namespace gps {
 	    // Initializes all the buffer objects/arrays
 	    void setupMesh();
 
+	    // Fills in the bounds and the texture coordinate density
+	    void computeBounds();
+
+	    void bindTextures(gps::Shader& shader);
+	    void unbindTextures();
+
     };
 
 }
@@ -1,7 +1,127 @@
 #include "Model3D.hpp"
+#include "RenderBackend.hpp"
+#include "TextureManager.hpp"
+
+#include <algorithm>
+#include <fstream>
 
 namespace gps {
 
+	namespace {
+
+		// every texture file the materials refer to, duplicates are skipped by the manager
+		std::vector<std::string> materialTexturePaths(const std::vector<tinyobj::material_t>& materials, const std::string& basePath) {
+
+			std::vector<std::string> paths;
+			for (size_t i = 0; i < materials.size(); i++) {
+
+				if (!materials[i].ambient_texname.empty())
+					paths.push_back(basePath + materials[i].ambient_texname);
+				if (!materials[i].diffuse_texname.empty())
+					paths.push_back(basePath + materials[i].diffuse_texname);
+				if (!materials[i].specular_texname.empty())
+					paths.push_back(basePath + materials[i].specular_texname);
+			}
+			return paths;
+		}
+
+		// the texture files the materials use in one role, specular maps are data and the others colour
+		std::vector<std::string> materialTexturePaths(const std::vector<tinyobj::material_t>& materials, const std::string& basePath, gps::TextureRole role) {
+
+			std::vector<std::string> paths;
+			for (size_t i = 0; i < materials.size(); i++) {
+
+				if (role == gps::TEXTURE_DATA) {
+					if (!materials[i].specular_texname.empty())
+						paths.push_back(basePath + materials[i].specular_texname);
+					continue;
+				}
+				if (!materials[i].ambient_texname.empty())
+					paths.push_back(basePath + materials[i].ambient_texname);
+				if (!materials[i].diffuse_texname.empty())
+					paths.push_back(basePath + materials[i].diffuse_texname);
+			}
+			return paths;
+		}
+
+		// small images whose every mesh uses them alone and within [0, 1], they can share an atlas
+		std::vector<std::string> atlasCandidates(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+			const std::vector<tinyobj::material_t>& materials, const std::string& basePath) {
+
+			std::unordered_map<std::string, bool> usable;
+			for (size_t s = 0; s < shapes.size(); s++) {
+
+				if (shapes[s].mesh.material_ids.empty() || shapes[s].mesh.material_ids[0] < 0)
+					continue;
+				const tinyobj::material_t& material = materials[shapes[s].mesh.material_ids[0]];
+
+				//the mesh has one set of coordinates for all its textures
+				std::vector<std::string> paths = materialTexturePaths(std::vector<tinyobj::material_t>(1, material), basePath);
+				bool single = material.specular_texname.empty() && std::all_of(paths.begin(), paths.end(), [&paths](const std::string& path) { return path == paths[0]; });
+
+				bool inside = true;
+				const float epsilon = 1e-3f;
+				for (size_t i = 0; i < shapes[s].mesh.indices.size() && inside; i++) {
+					int texcoord = shapes[s].mesh.indices[i].texcoord_index;
+					if (texcoord < 0)
+						continue;
+					float u = attrib.texcoords[2 * texcoord + 0];
+					float v = attrib.texcoords[2 * texcoord + 1];
+					inside = u >= -epsilon && u <= 1.0f + epsilon && v >= -epsilon && v <= 1.0f + epsilon;
+				}
+
+				for (size_t i = 0; i < paths.size(); i++) {
+					std::unordered_map<std::string, bool>::iterator found = usable.find(paths[i]);
+					bool ok = single && inside;
+					usable[paths[i]] = found == usable.end() ? ok : found->second && ok;
+				}
+			}
+
+			std::vector<std::string> candidates;
+			for (std::unordered_map<std::string, bool>::iterator it = usable.begin(); it != usable.end(); ++it) {
+				if (it->second && gps::TextureAtlas::isSmallImage(it->first))
+					candidates.push_back(it->first);
+			}
+			std::sort(candidates.begin(), candidates.end());
+			return candidates;
+		}
+
+		// specular maps hold reflectance data, the other maps colour
+		gps::TextureRole textureRole(const std::string& type) {
+
+			return type == "specularTexture" ? gps::TEXTURE_DATA : gps::TEXTURE_COLOR;
+		}
+	}
+
+	std::vector<std::string> Model3D::getTexturePaths(std::string mtlFileName, std::string basePath) {
+
+		std::ifstream mtlFile(mtlFileName);
+		if (!mtlFile) {
+			return std::vector<std::string>();
+		}
+
+		std::map<std::string, int> materialMap;
+		std::vector<tinyobj::material_t> materials;
+		tinyobj::LoadMtl(&materialMap, &materials, &mtlFile);
+
+		return materialTexturePaths(materials, basePath);
+	}
+
+	void Model3D::PrefetchTextures(std::string mtlFileName, std::string basePath) {
+
+		std::ifstream mtlFile(mtlFileName);
+		if (!mtlFile) {
+			return;
+		}
+
+		std::map<std::string, int> materialMap;
+		std::vector<tinyobj::material_t> materials;
+		tinyobj::LoadMtl(&materialMap, &materials, &mtlFile);
+
+		gps::TextureManager::getInstance().Prefetch(materialTexturePaths(materials, basePath, gps::TEXTURE_COLOR), gps::TEXTURE_COLOR);
+		gps::TextureManager::getInstance().Prefetch(materialTexturePaths(materials, basePath, gps::TEXTURE_DATA), gps::TEXTURE_DATA);
+	}
+
 	void Model3D::LoadModel(std::string fileName) {
 
         std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
@@ -14,12 +134,62 @@ namespace gps {
 	}
 
 	// Draw each mesh from the model
-	void Model3D::Draw(gps::Shader shaderProgram) {
+	void Model3D::Draw(gps::Shader& shaderProgram) {
 
 		for (int i = 0; i < meshes.size(); i++)
 			meshes[i].Draw(shaderProgram);
 	}
 
+	void Model3D::DrawInstanced(gps::Shader& shaderProgram, GLsizei instanceCount) {
+
+		for (size_t i = 0; i < meshes.size(); i++)
+			meshes[i].DrawInstanced(shaderProgram, instanceCount);
+	}
+
+	void Model3D::setInstanceBuffer(GLuint instanceVBO) {
+
+		for (size_t i = 0; i < meshes.size(); i++)
+			meshes[i].setInstanceBuffer(instanceVBO);
+	}
+
+
+	void Model3D::RequestMips(gps::TextureStreamer& streamer, const glm::mat4& model, const glm::vec3& cameraPosition, float projectionScale) {
+
+		// the largest axis scale, so the estimate errs towards finer levels
+		float scale = std::max(std::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+
+		for (size_t i = 0; i < meshes.size(); i++) {
+
+			if (meshes[i].uvDensity <= 0.0f)
+				continue;
+
+			// nearest point of the bounding sphere, the camera may be inside it
+			glm::vec3 center = glm::vec3(model * glm::vec4(meshes[i].boundsCenter, 1.0f));
+			float distance = std::max(glm::length(center - cameraPosition) - meshes[i].boundsRadius * scale, 0.1f);
+			float uvPerPixel = meshes[i].uvDensity / scale * distance / projectionScale;
+
+			for (size_t t = 0; t < meshes[i].textures.size(); t++)
+				streamer.Request(meshes[i].textures[t].id, uvPerPixel);
+		}
+	}
+
+	std::vector<gps::Mesh>& Model3D::getMeshes() {
+
+		return meshes;
+	}
+
+	void Model3D::ReleaseTextures(const std::vector<GLuint>& ids) {
+
+		for (std::unordered_map<std::string, gps::Texture>::iterator it = loadedTextures.begin(); it != loadedTextures.end();) {
+
+			if (it->second.id != 0 && std::find(ids.begin(), ids.end(), it->second.id) != ids.end()) {
+				gps::TextureManager::getInstance().Release(it->second.path, textureRole(it->second.type));
+				it = loadedTextures.erase(it);
+			}
+			else
+				++it;
+		}
+	}
 
 	// Does the parsing of the .obj file and fills in the data structure
 	void Model3D::ReadOBJ(std::string fileName, std::string basePath) {
@@ -47,6 +217,21 @@ namespace gps {
 		std::cout << "# of shapes    : " << shapes.size() << std::endl;
 		std::cout << "# of materials : " << materials.size() << std::endl;
 
+		// small images go into atlases instead of textures of their own
+		std::vector<std::string> atlasPaths = atlasCandidates(attrib, shapes, materials, basePath);
+		std::vector<std::string> colorPaths = materialTexturePaths(materials, basePath, gps::TEXTURE_COLOR);
+		std::vector<std::string> dataPaths = materialTexturePaths(materials, basePath, gps::TEXTURE_DATA);
+		for (size_t i = 0; i < atlasPaths.size(); i++) {
+			colorPaths.erase(std::remove(colorPaths.begin(), colorPaths.end(), atlasPaths[i]), colorPaths.end());
+			dataPaths.erase(std::remove(dataPaths.begin(), dataPaths.end(), atlasPaths[i]), dataPaths.end());
+			gps::TextureManager::getInstance().CancelPrefetch(atlasPaths[i]);
+		}
+
+		// decode on the workers while the vertex data is built, each file in the role its meshes acquire it with
+		gps::TextureManager::getInstance().Prefetch(colorPaths, gps::TEXTURE_COLOR);
+		gps::TextureManager::getInstance().Prefetch(dataPaths, gps::TEXTURE_DATA);
+		BuildAtlases(atlasPaths);
+
 		// Loop over shapes
 		for (size_t s = 0; s < shapes.size(); s++) {
 
@@ -117,8 +302,34 @@ namespace gps {
 
 					//ambient texture
 					std::string ambientTexturePath = materials[materialId].ambient_texname;
+					std::string diffuseTexturePath = materials[materialId].diffuse_texname;
 
-					if (!ambientTexturePath.empty()) {
+					//a packed image, the coordinates move into its rectangle
+					std::string atlasPath = basePath + (diffuseTexturePath.empty() ? ambientTexturePath : diffuseTexturePath);
+					gps::TextureAtlas* atlas = NULL;
+					for (size_t i = 0; i < atlases.size() && !atlas; i++) {
+						if (atlases[i].contains(atlasPath))
+							atlas = &atlases[i];
+					}
+
+					if (atlas) {
+
+						for (size_t i = 0; i < vertices.size(); i++)
+							vertices[i].TexCoords = atlas->remap(atlasPath, vertices[i].TexCoords);
+
+						gps::Texture atlasTexture;
+						atlasTexture.id = atlas->getTexture();
+						atlasTexture.path = atlasPath;
+						if (!ambientTexturePath.empty()) {
+							atlasTexture.type = "ambientTexture";
+							textures.push_back(atlasTexture);
+						}
+						if (!diffuseTexturePath.empty()) {
+							atlasTexture.type = "diffuseTexture";
+							textures.push_back(atlasTexture);
+						}
+					}
+					else if (!ambientTexturePath.empty()) {
 
 						gps::Texture currentTexture;
 						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
@@ -126,9 +337,7 @@ namespace gps {
 					}
 
 					//diffuse texture
-					std::string diffuseTexturePath = materials[materialId].diffuse_texname;
-
-					if (!diffuseTexturePath.empty()) {
+					if (!atlas && !diffuseTexturePath.empty()) {
 
 						gps::Texture currentTexture;
 						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
@@ -138,7 +347,7 @@ namespace gps {
 					//specular texture
 					std::string specularTexturePath = materials[materialId].specular_texname;
 
-					if (!specularTexturePath.empty()) {
+					if (!atlas && !specularTexturePath.empty()) {
 
 						gps::Texture currentTexture;
 						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
@@ -151,107 +360,87 @@ namespace gps {
 		}
 	}
 
-	// Retrieves a texture associated with the object - by its name and type
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
-
-			for (int i = 0; i < loadedTextures.size(); i++) {
+	void Model3D::BuildAtlases(const std::vector<std::string>& paths) {
 
-				if (loadedTextures[i].path == path)	{
+		std::vector<std::string> remaining = paths;
+		while (!remaining.empty()) {
 
-					//already loaded texture
-					return loadedTextures[i];
-				}
+			gps::TextureAtlas atlas;
+			std::vector<std::string> left = atlas.Build(remaining, gps::TextureManager::getInstance().isCompressionEnabled());
+			// a lone image is better off in a texture of its own
+			if (atlas.getImageCount() < 2) {
+				atlas.Delete();
+				break;
 			}
 
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
-			currentTexture.path = path;
-
-			loadedTextures.push_back(currentTexture);
-
-			return currentTexture;
+			atlases.push_back(atlas);
+			remaining = left;
 		}
 
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
-
-		int x, y, n;
-		int force_channels = 4;
-		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
-
-		if (!image_data) {
-			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
-		}
-		// NPOT check
-		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
-			fprintf(
-				stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
-			);
+		if (atlases.empty())
+			return;
+
+		// what the model saved in texture objects, and so in binds
+		int packed = 0;
+		size_t bytes = 0;
+		std::cout << "# of atlases   : " << atlases.size() << " (";
+		for (size_t i = 0; i < atlases.size(); i++) {
+			packed += atlases[i].getImageCount();
+			bytes += atlases[i].getBytes();
+			std::cout << (i > 0 ? ", " : "") << atlases[i].getWidth() << "x" << atlases[i].getHeight();
 		}
+		std::cout << ") holding " << packed << " textures, " << packed - (int)atlases.size() << " texture objects saved, "
+			<< bytes / 1024 << " KB" << std::endl;
+	}
 
-		int width_in_bytes = x * 4;
-		unsigned char *top = NULL;
-		unsigned char *bottom = NULL;
-		unsigned char temp = 0;
-		int half_height = y / 2;
+	// Retrieves a texture associated with the object - by its name and type
+	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
 
-		for (int row = 0; row < half_height; row++) {
+			gps::TextureRole role = textureRole(type);
+			std::string key = role == gps::TEXTURE_DATA ? path + "|data" : path;
+			std::unordered_map<std::string, gps::Texture>::iterator found = loadedTextures.find(key);
 
-			top = image_data + row * width_in_bytes;
-			bottom = image_data + (y - row - 1) * width_in_bytes;
+			if (found == loadedTextures.end()) {
 
-			for (int col = 0; col < width_in_bytes; col++) {
+				//first use by this model, shared with the other models through the manager
+				gps::Texture texture;
+				texture.id = gps::TextureManager::getInstance().Acquire(path, role);
+				texture.type = type;
+				texture.path = path;
 
-				temp = *top;
-				*top = *bottom;
-				*bottom = temp;
-				top++;
-				bottom++;
+				found = loadedTextures.insert(std::make_pair(key, texture)).first;
 			}
+
+			//the same image may be used with another role by a different material
+			gps::Texture currentTexture = found->second;
+			currentTexture.type = std::string(type);
+
+			return currentTexture;
 		}
 
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			image_data
-		);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		return textureID;
-	}
+	void Model3D::Delete() {
 
-	Model3D::~Model3D() {
+        for (size_t i = 0; i < atlases.size(); i++)
+            atlases[i].Delete();
+        atlases.clear();
 
-        for (size_t i = 0; i < loadedTextures.size(); i++) {
+        for (std::unordered_map<std::string, gps::Texture>::iterator it = loadedTextures.begin(); it != loadedTextures.end(); ++it) {
 
-            glDeleteTextures(1, &loadedTextures.at(i).id);
+            if (it->second.id != 0)
+                gps::TextureManager::getInstance().Release(it->second.path, textureRole(it->second.type));
         }
+        loadedTextures.clear();
 
+        RenderBackend& backend = RenderBackend::getCurrent();
         for (size_t i = 0; i < meshes.size(); i++) {
 
             GLuint VBO = meshes.at(i).getBuffers().VBO;
             GLuint EBO = meshes.at(i).getBuffers().EBO;
             GLuint VAO = meshes.at(i).getBuffers().VAO;
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteVertexArrays(1, &VAO);
+            backend.DeleteBuffers(1, &VBO);
+            backend.DeleteBuffers(1, &EBO);
+            backend.DeleteVertexArrays(1, &VAO);
         }
+        meshes.clear();
 	}
 }
@@ -2,6 +2,8 @@
 #define Model3D_hpp
 
 #include "Mesh.hpp"
+#include "TextureStreamer.hpp"
+#include "TextureAtlas.hpp"
 
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
@@ -27,28 +29,53 @@ namespace gps {
 
 
     public:
-        ~Model3D();
-
 		void LoadModel(std::string fileName);
 
 		void LoadModel(std::string fileName, std::string basePath);
 
-		void Draw(gps::Shader shaderProgram);
+		// Texture files named by a material library
+		static std::vector<std::string> getTexturePaths(std::string mtlFileName, std::string basePath);
+
+		// Starts decoding the textures of a material library before the models using it are loaded
+		static void PrefetchTextures(std::string mtlFileName, std::string basePath);
+
+		void Draw(gps::Shader& shaderProgram);
+
+		// Draws instanceCount copies of every mesh, see setInstanceBuffer()
+		void DrawInstanced(gps::Shader& shaderProgram, GLsizei instanceCount);
+
+		// Attaches a buffer of per instance model matrices to every mesh
+		void setInstanceBuffer(GLuint instanceVBO);
+
+		// Tells the streamer which mip level each texture needs at this distance from the camera
+		// projectionScale is the height in pixels of one unit at unit distance
+		void RequestMips(gps::TextureStreamer& streamer, const glm::mat4& model, const glm::vec3& cameraPosition, float projectionScale);
+
+		// Component meshes, for the systems working on every draw of the scene
+		std::vector<gps::Mesh>& getMeshes();
+
+		// Hands textures copied elsewhere back to the TextureManager, the meshes must not bind them anymore
+		void ReleaseTextures(const std::vector<GLuint>& ids);
+
+		// Releases the textures and frees the buffers, while the context and the TextureManager are still alive
+		void Delete();
 
     private:
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
-		// Associated textures
-        std::vector<gps::Texture> loadedTextures;
+		// Associated textures by path and role, owned by the TextureManager
+        std::unordered_map<std::string, gps::Texture> loadedTextures;
+		// Small textures packed together, owned by the model
+		std::vector<gps::TextureAtlas> atlases;
 
 		// Does the parsing of the .obj file and fills in the data structure
 		void ReadOBJ(std::string fileName, std::string basePath);
 
+		// Packs the small images of the meshes that never repeat them, see TextureAtlas
+		void BuildAtlases(const std::vector<std::string>& paths);
+
 		// Retrieves a texture associated with the object - by its name and type
 		gps::Texture LoadTexture(std::string path, std::string type);
-
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
     };
 }
 
@@ -0,0 +1,592 @@
+#include "NullRenderBackend.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+    #define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const char* COMMAND_NAMES[COMMAND_COUNT] = {
+            "shader", "program", "use program", "uniform lookup", "uniform",
+            "vertex array", "bind vertex array", "buffer", "bind buffer", "buffer upload",
+            "vertex format", "texture", "bind texture", "texture parameter", "texture upload",
+            "framebuffer", "bind framebuffer", "state", "clear", "draw",
+            "query", "readback", "sync"
+        };
+
+        // bytes of one uncompressed texel as the data is handed over, not as it is stored
+        uint64_t getTexelBytes(GLenum format, GLenum type) {
+
+            uint64_t channels = 4;
+            switch (format) {
+            case GL_RED:
+            case GL_DEPTH_COMPONENT:
+                channels = 1;
+                break;
+            case GL_RG:
+                channels = 2;
+                break;
+            case GL_RGB:
+            case GL_BGR:
+                channels = 3;
+                break;
+            }
+            return channels * (type == GL_FLOAT ? 4 : 1);
+        }
+    }
+
+    NullRenderBackend::NullRenderBackend() {
+
+        nextName = 0;
+        Reset();
+    }
+
+    void NullRenderBackend::Reset() {
+
+        std::fill(counts, counts + COMMAND_COUNT, 0);
+        vertices = 0;
+        instances = 0;
+        uploadedBytes = 0;
+    }
+
+    void NullRenderBackend::Record(RENDER_COMMAND command) {
+
+        counts[command]++;
+    }
+
+    void NullRenderBackend::Generate(RENDER_COMMAND command, GLsizei count, GLuint* names) {
+
+        Record(command);
+        for (GLsizei i = 0; i < count; i++) {
+            names[i] = ++nextName;
+        }
+    }
+
+    uint64_t NullRenderBackend::getCount(RENDER_COMMAND command) {
+
+        return counts[command];
+    }
+
+    uint64_t NullRenderBackend::getTotalCount() {
+
+        uint64_t total = 0;
+        for (int i = 0; i < COMMAND_COUNT; i++) {
+            total += counts[i];
+        }
+        return total;
+    }
+
+    uint64_t NullRenderBackend::getDrawCount() {
+
+        return counts[COMMAND_DRAW];
+    }
+
+    uint64_t NullRenderBackend::getVertexCount() {
+
+        return vertices;
+    }
+
+    uint64_t NullRenderBackend::getInstanceCount() {
+
+        return instances;
+    }
+
+    uint64_t NullRenderBackend::getUploadedBytes() {
+
+        return uploadedBytes;
+    }
+
+    const char* NullRenderBackend::getCommandName(RENDER_COMMAND command) {
+
+        return COMMAND_NAMES[command];
+    }
+
+    void NullRenderBackend::printStats(int frames) {
+
+        double perFrame = 1.0 / std::max(1, frames);
+        std::cout << "Null render backend, per frame over " << frames << " frames: " << getTotalCount() * perFrame << " commands, "
+            << counts[COMMAND_DRAW] * perFrame << " draws, " << vertices * perFrame << " vertices, "
+            << instances * perFrame << " instances, " << uploadedBytes * perFrame / 1024.0 << " KB uploaded" << std::endl;
+
+        std::vector<int> order;
+        for (int i = 0; i < COMMAND_COUNT; i++) {
+            if (counts[i] > 0)
+                order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return counts[a] > counts[b]; });
+        for (size_t i = 0; i < order.size(); i++) {
+            std::cout << "  " << COMMAND_NAMES[order[i]] << ": " << counts[order[i]] * perFrame << std::endl;
+        }
+    }
+
+    GLuint NullRenderBackend::CreateShader(GLenum type) {
+
+        Record(COMMAND_SHADER);
+        return ++nextName;
+    }
+
+    void NullRenderBackend::ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+
+        Record(COMMAND_SHADER);
+    }
+
+    void NullRenderBackend::CompileShader(GLuint shader) {
+
+        Record(COMMAND_SHADER);
+    }
+
+    void NullRenderBackend::GetShaderiv(GLuint shader, GLenum name, GLint* value) {
+
+        Record(COMMAND_READBACK);
+        *value = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+
+    void NullRenderBackend::GetShaderInfoLog(GLuint shader, GLsizei size, GLsizei* length, GLchar* log) {
+
+        Record(COMMAND_READBACK);
+        if (length) {
+            *length = 0;
+        }
+        if (size > 0) {
+            log[0] = '\0';
+        }
+    }
+
+    void NullRenderBackend::DeleteShader(GLuint shader) {
+
+        Record(COMMAND_SHADER);
+    }
+
+    GLuint NullRenderBackend::CreateProgram() {
+
+        Record(COMMAND_PROGRAM);
+        return ++nextName;
+    }
+
+    void NullRenderBackend::AttachShader(GLuint program, GLuint shader) {
+
+        Record(COMMAND_PROGRAM);
+    }
+
+    void NullRenderBackend::LinkProgram(GLuint program) {
+
+        Record(COMMAND_PROGRAM);
+    }
+
+    void NullRenderBackend::ProgramParameteri(GLuint program, GLenum name, GLint value) {
+
+        Record(COMMAND_PROGRAM);
+    }
+
+    void NullRenderBackend::GetProgramiv(GLuint program, GLenum name, GLint* value) {
+
+        Record(COMMAND_READBACK);
+        *value = (name == GL_LINK_STATUS || name == GL_COMPLETION_STATUS_KHR) ? GL_TRUE : 0;
+    }
+
+    void NullRenderBackend::GetProgramInfoLog(GLuint program, GLsizei size, GLsizei* length, GLchar* log) {
+
+        Record(COMMAND_READBACK);
+        if (length) {
+            *length = 0;
+        }
+        if (size > 0) {
+            log[0] = '\0';
+        }
+    }
+
+    void NullRenderBackend::ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length) {
+
+        Record(COMMAND_PROGRAM);
+    }
+
+    void NullRenderBackend::GetProgramBinary(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary) {
+
+        Record(COMMAND_READBACK);
+        if (length) {
+            *length = 0;
+        }
+        *format = 0;
+    }
+
+    void NullRenderBackend::DeleteProgram(GLuint program) {
+
+        Record(COMMAND_PROGRAM);
+    }
+
+    void NullRenderBackend::UseProgram(GLuint program) {
+
+        Record(COMMAND_USE_PROGRAM);
+    }
+
+    GLint NullRenderBackend::GetUniformLocation(GLuint program, const GLchar* name) {
+
+        Record(COMMAND_UNIFORM_LOCATION);
+        return 0;
+    }
+
+    void NullRenderBackend::Uniform1i(GLint location, GLint value) {
+
+        Record(COMMAND_UNIFORM);
+    }
+
+    void NullRenderBackend::Uniform1f(GLint location, GLfloat value) {
+
+        Record(COMMAND_UNIFORM);
+    }
+
+    void NullRenderBackend::Uniform2f(GLint location, GLfloat x, GLfloat y) {
+
+        Record(COMMAND_UNIFORM);
+    }
+
+    void NullRenderBackend::Uniform3fv(GLint location, GLsizei count, const GLfloat* values) {
+
+        Record(COMMAND_UNIFORM);
+    }
+
+    void NullRenderBackend::UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) {
+
+        Record(COMMAND_UNIFORM);
+    }
+
+    void NullRenderBackend::UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) {
+
+        Record(COMMAND_UNIFORM);
+    }
+
+    void NullRenderBackend::GenVertexArrays(GLsizei count, GLuint* arrays) {
+
+        Generate(COMMAND_VERTEX_ARRAY, count, arrays);
+    }
+
+    void NullRenderBackend::DeleteVertexArrays(GLsizei count, const GLuint* arrays) {
+
+        Record(COMMAND_VERTEX_ARRAY);
+    }
+
+    void NullRenderBackend::BindVertexArray(GLuint array) {
+
+        Record(COMMAND_BIND_VERTEX_ARRAY);
+    }
+
+    void NullRenderBackend::GenBuffers(GLsizei count, GLuint* buffers) {
+
+        Generate(COMMAND_BUFFER, count, buffers);
+    }
+
+    void NullRenderBackend::DeleteBuffers(GLsizei count, const GLuint* buffers) {
+
+        Record(COMMAND_BUFFER);
+    }
+
+    void NullRenderBackend::BindBuffer(GLenum target, GLuint buffer) {
+
+        Record(COMMAND_BIND_BUFFER);
+    }
+
+    void NullRenderBackend::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+
+        //without data it only allocates, or orphans the old store
+        Record(COMMAND_BUFFER_UPLOAD);
+        if (data) {
+            uploadedBytes += size;
+        }
+    }
+
+    void NullRenderBackend::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+
+        Record(COMMAND_BUFFER_UPLOAD);
+        uploadedBytes += size;
+    }
+
+    void* NullRenderBackend::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+
+        //no memory behind the buffers, the caller takes it as a failed mapping
+        Record(COMMAND_BUFFER_UPLOAD);
+        return NULL;
+    }
+
+    GLboolean NullRenderBackend::UnmapBuffer(GLenum target) {
+
+        Record(COMMAND_BUFFER_UPLOAD);
+        return GL_FALSE;
+    }
+
+    void NullRenderBackend::EnableVertexAttribArray(GLuint index) {
+
+        Record(COMMAND_VERTEX_FORMAT);
+    }
+
+    void NullRenderBackend::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset) {
+
+        Record(COMMAND_VERTEX_FORMAT);
+    }
+
+    void NullRenderBackend::VertexAttribDivisor(GLuint index, GLuint divisor) {
+
+        Record(COMMAND_VERTEX_FORMAT);
+    }
+
+    void NullRenderBackend::GenTextures(GLsizei count, GLuint* textures) {
+
+        Generate(COMMAND_TEXTURE, count, textures);
+    }
+
+    void NullRenderBackend::DeleteTextures(GLsizei count, const GLuint* textures) {
+
+        Record(COMMAND_TEXTURE);
+    }
+
+    void NullRenderBackend::ActiveTexture(GLenum unit) {
+
+        Record(COMMAND_BIND_TEXTURE);
+    }
+
+    void NullRenderBackend::BindTexture(GLenum target, GLuint texture) {
+
+        Record(COMMAND_BIND_TEXTURE);
+    }
+
+    void NullRenderBackend::TexParameteri(GLenum target, GLenum name, GLint value) {
+
+        Record(COMMAND_TEXTURE_PARAMETER);
+    }
+
+    void NullRenderBackend::TexParameteriv(GLenum target, GLenum name, const GLint* values) {
+
+        Record(COMMAND_TEXTURE_PARAMETER);
+    }
+
+    void NullRenderBackend::TexParameterfv(GLenum target, GLenum name, const GLfloat* values) {
+
+        Record(COMMAND_TEXTURE_PARAMETER);
+    }
+
+    void NullRenderBackend::TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* data) {
+
+        Record(COMMAND_TEXTURE_UPLOAD);
+        if (data) {
+            uploadedBytes += (uint64_t)width * height * getTexelBytes(format, type);
+        }
+    }
+
+    void NullRenderBackend::CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei size, const void* data) {
+
+        Record(COMMAND_TEXTURE_UPLOAD);
+        if (data) {
+            uploadedBytes += size;
+        }
+    }
+
+    void NullRenderBackend::TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data) {
+
+        //from a pixel buffer data is an offset, the bytes go over either way
+        Record(COMMAND_TEXTURE_UPLOAD);
+        uploadedBytes += (uint64_t)width * height * getTexelBytes(format, type);
+    }
+
+    void NullRenderBackend::CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei size, const void* data) {
+
+        Record(COMMAND_TEXTURE_UPLOAD);
+        uploadedBytes += size;
+    }
+
+    void NullRenderBackend::GenerateMipmap(GLenum target) {
+
+        Record(COMMAND_TEXTURE_UPLOAD);
+    }
+
+    void NullRenderBackend::TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) {
+
+        Record(COMMAND_TEXTURE_PARAMETER);
+    }
+
+    void NullRenderBackend::PixelStorei(GLenum name, GLint value) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::GenFramebuffers(GLsizei count, GLuint* framebuffers) {
+
+        Generate(COMMAND_FRAMEBUFFER, count, framebuffers);
+    }
+
+    void NullRenderBackend::BindFramebuffer(GLenum target, GLuint framebuffer) {
+
+        Record(COMMAND_BIND_FRAMEBUFFER);
+    }
+
+    void NullRenderBackend::FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) {
+
+        Record(COMMAND_FRAMEBUFFER);
+    }
+
+    void NullRenderBackend::DrawBuffer(GLenum buffer) {
+
+        Record(COMMAND_FRAMEBUFFER);
+    }
+
+    void NullRenderBackend::ReadBuffer(GLenum buffer) {
+
+        Record(COMMAND_FRAMEBUFFER);
+    }
+
+    void NullRenderBackend::Enable(GLenum capability) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::Clear(GLbitfield mask) {
+
+        Record(COMMAND_CLEAR);
+    }
+
+    void NullRenderBackend::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::DepthFunc(GLenum func) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::DepthMask(GLboolean flag) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::CullFace(GLenum mode) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::FrontFace(GLenum mode) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::PolygonMode(GLenum face, GLenum mode) {
+
+        Record(COMMAND_STATE);
+    }
+
+    void NullRenderBackend::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+
+        Record(COMMAND_DRAW);
+        vertices += count;
+        instances++;
+    }
+
+    void NullRenderBackend::DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) {
+
+        Record(COMMAND_DRAW);
+        vertices += count;
+        instances++;
+    }
+
+    void NullRenderBackend::DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) {
+
+        Record(COMMAND_DRAW);
+        vertices += (uint64_t)count * instanceCount;
+        instances += instanceCount;
+    }
+
+    void NullRenderBackend::GenQueries(GLsizei count, GLuint* queries) {
+
+        Generate(COMMAND_QUERY, count, queries);
+    }
+
+    void NullRenderBackend::DeleteQueries(GLsizei count, const GLuint* queries) {
+
+        Record(COMMAND_QUERY);
+    }
+
+    void NullRenderBackend::BeginQuery(GLenum target, GLuint query) {
+
+        Record(COMMAND_QUERY);
+    }
+
+    void NullRenderBackend::EndQuery(GLenum target) {
+
+        Record(COMMAND_QUERY);
+    }
+
+    void NullRenderBackend::QueryCounter(GLuint query, GLenum target) {
+
+        Record(COMMAND_QUERY);
+    }
+
+    void NullRenderBackend::GetQueryObjectiv(GLuint query, GLenum name, GLint* value) {
+
+        Record(COMMAND_READBACK);
+        *value = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+    }
+
+    void NullRenderBackend::GetQueryObjectui64v(GLuint query, GLenum name, GLuint64* value) {
+
+        Record(COMMAND_READBACK);
+        *value = 0;
+    }
+
+    GLsync NullRenderBackend::FenceSync(GLenum condition, GLbitfield flags) {
+
+        //any non null handle, it is never dereferenced
+        Record(COMMAND_SYNC);
+        return (GLsync)(uintptr_t)++nextName;
+    }
+
+    GLenum NullRenderBackend::ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+
+        Record(COMMAND_SYNC);
+        return GL_ALREADY_SIGNALED;
+    }
+
+    void NullRenderBackend::DeleteSync(GLsync sync) {
+
+        Record(COMMAND_SYNC);
+    }
+
+    void NullRenderBackend::GetIntegerv(GLenum name, GLint* value) {
+
+        Record(COMMAND_READBACK);
+        *value = 0;
+    }
+
+    const GLubyte* NullRenderBackend::GetString(GLenum name) {
+
+        Record(COMMAND_READBACK);
+        switch (name) {
+        case GL_VENDOR:
+            return (const GLubyte*)"none";
+        case GL_RENDERER:
+            return (const GLubyte*)"Null render backend";
+        case GL_VERSION:
+            return (const GLubyte*)"4.1 (commands counted, not executed)";
+        }
+        return (const GLubyte*)"";
+    }
+
+    GLenum NullRenderBackend::GetError() {
+
+        Record(COMMAND_READBACK);
+        return GL_NO_ERROR;
+    }
+}
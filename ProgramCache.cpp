@@ -0,0 +1,185 @@
+#include "ProgramCache.hpp"
+#include "Hash.hpp"
+#include "RenderBackend.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined (_WIN32)
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const uint32_t CACHE_MAGIC = 0x42535047; // "GPSB"
+
+        std::string glString(GLenum name) {
+
+            const GLubyte* value = RenderBackend::getCurrent().GetString(name);
+            return value ? std::string((const char*)value) : std::string();
+        }
+    }
+
+    ProgramCache& ProgramCache::getInstance() {
+
+        static ProgramCache cache;
+        return cache;
+    }
+
+    ProgramCache::ProgramCache() {
+
+        directory = "shaders/cache/";
+        enabled = false;
+        hits = 0;
+        misses = 0;
+
+        //the driver has to support at least one binary format
+        GLint formats = 0;
+        RenderBackend::getCurrent().GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0) {
+            std::cout << "Program binary cache disabled, no binary formats supported" << std::endl;
+            return;
+        }
+
+        driverId = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+
+#if defined (_WIN32)
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        enabled = true;
+    }
+
+    std::string ProgramCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource) {
+
+        uint64_t hash = hashString(driverId);
+        hash = hashString(vertexSource, hash);
+        //separator so moving text between the two stages changes the key
+        hash = hashString("\n--fragment--\n", hash);
+        hash = hashString(fragmentSource, hash);
+
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+        return std::string(key);
+    }
+
+    std::string ProgramCache::getPath(const std::string& key) {
+
+        return directory + key + ".bin";
+    }
+
+    GLuint ProgramCache::Load(const std::string& key) {
+
+        if (!enabled) {
+            return 0;
+        }
+
+        std::ifstream file(getPath(key), std::ios::binary);
+        if (!file) {
+            misses++;
+            return 0;
+        }
+
+        uint32_t magic = 0, format = 0, length = 0;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&format, sizeof(format));
+        file.read((char*)&length, sizeof(length));
+
+        //a foreign or truncated file must not size the allocation
+        std::streamoff header = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff remaining = file.tellg() - header;
+        file.seekg(header);
+
+        std::vector<char> binary;
+        if (file && magic == CACHE_MAGIC && length > 0 && (std::streamoff)length <= remaining) {
+            binary.resize(length);
+            file.read(binary.data(), length);
+        }
+
+        if (binary.empty() || !file) {
+            file.close();
+            std::remove(getPath(key).c_str());
+            misses++;
+            return 0;
+        }
+        file.close();
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        GLuint program = backend.CreateProgram();
+        backend.ProgramBinary(program, (GLenum)format, binary.data(), (GLsizei)length);
+
+        //the driver may reject binaries from another build even with matching strings
+        GLint success = 0;
+        backend.GetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            std::cout << "Cached program " << key << " rejected by the driver, rebuilding" << std::endl;
+            backend.DeleteProgram(program);
+            std::remove(getPath(key).c_str());
+            misses++;
+            return 0;
+        }
+
+        hits++;
+        return program;
+    }
+
+    void ProgramCache::Store(const std::string& key, GLuint program) {
+
+        if (!enabled) {
+            return;
+        }
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        GLint length = 0;
+        backend.GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        backend.GetProgramBinary(program, length, NULL, &format, binary.data());
+
+        std::ofstream file(getPath(key), std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cout << "Could not write program cache " << getPath(key) << std::endl;
+            return;
+        }
+
+        uint32_t magic = CACHE_MAGIC, binaryFormat = format, binaryLength = (uint32_t)length;
+        file.write((const char*)&magic, sizeof(magic));
+        file.write((const char*)&binaryFormat, sizeof(binaryFormat));
+        file.write((const char*)&binaryLength, sizeof(binaryLength));
+        file.write(binary.data(), length);
+    }
+
+    bool ProgramCache::isEnabled() {
+
+        return enabled;
+    }
+
+    int ProgramCache::getHits() {
+
+        return hits;
+    }
+
+    int ProgramCache::getMisses() {
+
+        return misses;
+    }
+
+    void ProgramCache::resetStats() {
+
+        hits = 0;
+        misses = 0;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef ProgramCache_hpp
+#define ProgramCache_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <string>
+
+namespace gps {
+
+    // On-disk cache of linked program binaries, so later launches skip compiling and linking.
+    // Entries are keyed by the final shader sources (defines included) and the driver strings,
+    // a driver update or a source edit simply produces a new key.
+    class ProgramCache {
+
+    public:
+        static ProgramCache& getInstance();
+
+        std::string makeKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+        // creates a program from the cached binary, 0 when missing or rejected by the driver
+        GLuint Load(const std::string& key);
+        // saves a linked program that was created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+        void Store(const std::string& key, GLuint program);
+
+        bool isEnabled();
+        int getHits();
+        int getMisses();
+        void resetStats();
+
+    private:
+        ProgramCache();
+
+        std::string directory;
+        // vendor, renderer and version of the current context
+        std::string driverId;
+        bool enabled;
+        int hits;
+        int misses;
+
+        std::string getPath(const std::string& key);
+    };
+}
+
+#endif /* ProgramCache_hpp */
@@ -0,0 +1,26 @@
+#include "RenderBackend.hpp"
+#include "GLRenderBackend.hpp"
+
+#include <cstddef>
+
+namespace gps {
+
+    RenderBackend* RenderBackend::current = NULL;
+
+    RenderBackend& RenderBackend::getCurrent() {
+
+        return current ? *current : getOpenGL();
+    }
+
+    void RenderBackend::setCurrent(RenderBackend* backend) {
+
+        current = backend;
+    }
+
+    RenderBackend& RenderBackend::getOpenGL() {
+
+        //never destroyed, it holds no state and stays valid for anything freed late at exit
+        static GLRenderBackend* backend = new GLRenderBackend();
+        return *backend;
+    }
+}
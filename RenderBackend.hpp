@@ -0,0 +1,135 @@
+#ifndef RenderBackend_hpp
+#define RenderBackend_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+namespace gps {
+
+    // The GL commands the engine issues, behind one interface so they can go somewhere else than the driver.
+    // Every method is the GL function of the same name without the prefix and with the same arguments,
+    // GLRenderBackend calls it and NullRenderBackend only counts it. Whatever draws fetches the current
+    // backend once per call and issues everything through it, so a whole frame can run without a context.
+    class RenderBackend {
+
+    public:
+        virtual ~RenderBackend() {}
+
+        // the backend set last, OpenGL until one is set
+        static RenderBackend& getCurrent();
+        // NULL goes back to OpenGL, set before anything is created as the names are not shared
+        static void setCurrent(RenderBackend* backend);
+        static RenderBackend& getOpenGL();
+
+        // shaders and programs
+        virtual GLuint CreateShader(GLenum type) = 0;
+        virtual void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) = 0;
+        virtual void CompileShader(GLuint shader) = 0;
+        virtual void GetShaderiv(GLuint shader, GLenum name, GLint* value) = 0;
+        virtual void GetShaderInfoLog(GLuint shader, GLsizei size, GLsizei* length, GLchar* log) = 0;
+        virtual void DeleteShader(GLuint shader) = 0;
+        virtual GLuint CreateProgram() = 0;
+        virtual void AttachShader(GLuint program, GLuint shader) = 0;
+        virtual void LinkProgram(GLuint program) = 0;
+        virtual void ProgramParameteri(GLuint program, GLenum name, GLint value) = 0;
+        virtual void GetProgramiv(GLuint program, GLenum name, GLint* value) = 0;
+        virtual void GetProgramInfoLog(GLuint program, GLsizei size, GLsizei* length, GLchar* log) = 0;
+        virtual void ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length) = 0;
+        virtual void GetProgramBinary(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary) = 0;
+        virtual void DeleteProgram(GLuint program) = 0;
+        virtual void UseProgram(GLuint program) = 0;
+
+        // uniforms of the program in use
+        virtual GLint GetUniformLocation(GLuint program, const GLchar* name) = 0;
+        virtual void Uniform1i(GLint location, GLint value) = 0;
+        virtual void Uniform1f(GLint location, GLfloat value) = 0;
+        virtual void Uniform2f(GLint location, GLfloat x, GLfloat y) = 0;
+        virtual void Uniform3fv(GLint location, GLsizei count, const GLfloat* values) = 0;
+        virtual void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) = 0;
+        virtual void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) = 0;
+
+        // vertex arrays and buffers
+        virtual void GenVertexArrays(GLsizei count, GLuint* arrays) = 0;
+        virtual void DeleteVertexArrays(GLsizei count, const GLuint* arrays) = 0;
+        virtual void BindVertexArray(GLuint array) = 0;
+        virtual void GenBuffers(GLsizei count, GLuint* buffers) = 0;
+        virtual void DeleteBuffers(GLsizei count, const GLuint* buffers) = 0;
+        virtual void BindBuffer(GLenum target, GLuint buffer) = 0;
+        virtual void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+        virtual void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+        virtual void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) = 0;
+        virtual GLboolean UnmapBuffer(GLenum target) = 0;
+        virtual void EnableVertexAttribArray(GLuint index) = 0;
+        virtual void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset) = 0;
+        virtual void VertexAttribDivisor(GLuint index, GLuint divisor) = 0;
+
+        // textures
+        virtual void GenTextures(GLsizei count, GLuint* textures) = 0;
+        virtual void DeleteTextures(GLsizei count, const GLuint* textures) = 0;
+        virtual void ActiveTexture(GLenum unit) = 0;
+        virtual void BindTexture(GLenum target, GLuint texture) = 0;
+        virtual void TexParameteri(GLenum target, GLenum name, GLint value) = 0;
+        virtual void TexParameteriv(GLenum target, GLenum name, const GLint* values) = 0;
+        virtual void TexParameterfv(GLenum target, GLenum name, const GLfloat* values) = 0;
+        virtual void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* data) = 0;
+        virtual void CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei size, const void* data) = 0;
+        virtual void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data) = 0;
+        virtual void CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei size, const void* data) = 0;
+        virtual void GenerateMipmap(GLenum target) = 0;
+        virtual void TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) = 0;
+        virtual void PixelStorei(GLenum name, GLint value) = 0;
+
+        // framebuffers
+        virtual void GenFramebuffers(GLsizei count, GLuint* framebuffers) = 0;
+        virtual void BindFramebuffer(GLenum target, GLuint framebuffer) = 0;
+        virtual void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) = 0;
+        virtual void DrawBuffer(GLenum buffer) = 0;
+        virtual void ReadBuffer(GLenum buffer) = 0;
+
+        // fixed function state
+        virtual void Enable(GLenum capability) = 0;
+        virtual void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) = 0;
+        virtual void Clear(GLbitfield mask) = 0;
+        virtual void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+        virtual void DepthFunc(GLenum func) = 0;
+        virtual void DepthMask(GLboolean flag) = 0;
+        virtual void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) = 0;
+        virtual void CullFace(GLenum mode) = 0;
+        virtual void FrontFace(GLenum mode) = 0;
+        virtual void PolygonMode(GLenum face, GLenum mode) = 0;
+
+        // draws
+        virtual void DrawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+        virtual void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) = 0;
+        virtual void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) = 0;
+
+        // queries
+        virtual void GenQueries(GLsizei count, GLuint* queries) = 0;
+        virtual void DeleteQueries(GLsizei count, const GLuint* queries) = 0;
+        virtual void BeginQuery(GLenum target, GLuint query) = 0;
+        virtual void EndQuery(GLenum target) = 0;
+        virtual void QueryCounter(GLuint query, GLenum target) = 0;
+        virtual void GetQueryObjectiv(GLuint query, GLenum name, GLint* value) = 0;
+        virtual void GetQueryObjectui64v(GLuint query, GLenum name, GLuint64* value) = 0;
+
+        // fences
+        virtual GLsync FenceSync(GLenum condition, GLbitfield flags) = 0;
+        virtual GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) = 0;
+        virtual void DeleteSync(GLsync sync) = 0;
+
+        // context
+        virtual void GetIntegerv(GLenum name, GLint* value) = 0;
+        virtual const GLubyte* GetString(GLenum name) = 0;
+        virtual GLenum GetError() = 0;
+
+    private:
+        static RenderBackend* current;
+    };
+}
+
+#endif /* RenderBackend_hpp */
@@ -7,8 +7,13 @@
 //
 
 #include "Shader.hpp"
+#include "ProgramCache.hpp"
+#include "RenderBackend.hpp"
 
 namespace gps {
+
+    bool Shader::parallelCompile = false;
+
     std::string Shader::readShaderFile(std::string fileName) {
 
         std::ifstream shaderFile;
@@ -30,70 +35,271 @@ namespace gps {
         return shaderString;
     }
     
-    void Shader::shaderCompileLog(GLuint shaderId) {
+    bool Shader::shaderCompileLog(GLuint shaderId) {
 
+        RenderBackend& backend = RenderBackend::getCurrent();
         GLint success;
         GLchar infoLog[512];
         
         //check compilation info
-        glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+        backend.GetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
 
         if(!success) {
 
-            glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
+            backend.GetShaderInfoLog(shaderId, 512, NULL, infoLog);
             std::cout << "Shader compilation error\n" << infoLog << std::endl;
         }
+        return success;
     }
     
-    void Shader::shaderLinkLog(GLuint shaderProgramId) {
+    bool Shader::shaderLinkLog(GLuint shaderProgramId) {
 
+        RenderBackend& backend = RenderBackend::getCurrent();
         GLint success;
         GLchar infoLog[512];
         
         //check linking info
-        glGetProgramiv(shaderProgramId, GL_LINK_STATUS, &success);
+        backend.GetProgramiv(shaderProgramId, GL_LINK_STATUS, &success);
         if(!success) {
-            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            backend.GetProgramInfoLog(shaderProgramId, 512, NULL, infoLog);
             std::cout << "Shader linking error\n" << infoLog << std::endl;
         }
+        return success;
     }
     
-    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+    std::string Shader::injectDefines(const std::string& source, unsigned int features) {
+
+        static const char* featureNames[] = { "FLASH", "GREY", "FOG", "SHADOWS", "INSTANCED", "CLUSTERED" };
+
+        if (features == 0 && sourceDefines.empty()) {
+            return source;
+        }
+
+        std::string defines = sourceDefines;
+        for (unsigned int i = 0; i < sizeof(featureNames) / sizeof(featureNames[0]); i++) {
+
+            if (features & (1u << i)) {
+                defines += std::string("#define ") + featureNames[i] + "\n";
+            }
+        }
+
+        //the defines go right after #version, which has to stay the first statement
+        size_t insertPos = 0;
+        size_t versionPos = source.find("#version");
+        if (versionPos != std::string::npos) {
+            size_t versionEnd = source.find('\n', versionPos);
+            if (versionEnd == std::string::npos) {
+                return source;
+            }
+            insertPos = versionEnd + 1;
+        }
 
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
+        //keep the compiler's line numbers matching the file
+        size_t nextLine = 1;
+        for (size_t i = 0; i < insertPos; i++) {
+            if (source[i] == '\n') {
+                nextLine++;
+            }
+        }
+        defines += "#line " + std::to_string(nextLine) + "\n";
+
+        return source.substr(0, insertPos) + defines + source.substr(insertPos);
+    }
+
+    Shader::Variant& Shader::submitVariant(unsigned int features) {
+
+        std::unordered_map<unsigned int, Variant>::iterator existing = variants.find(features);
+        if (existing != variants.end()) {
+            return existing->second;
+        }
+
+        Variant& variant = variants[features];
+        variant.program = 0;
+        variant.vertexShader = 0;
+        variant.fragmentShader = 0;
+        variant.materialIndexLocation = -1;
+        variant.ready = false;
+        variant.failed = false;
+
+        std::string v = injectDefines(vertexSource, features);
+        std::string f = injectDefines(fragmentSource, features);
+
+        //a binary linked by an earlier run skips compiling altogether
+        ProgramCache& cache = ProgramCache::getInstance();
+        variant.cacheKey = cache.makeKey(v, f);
+        variant.program = cache.Load(variant.cacheKey);
+        if (variant.program != 0) {
+            variant.materialIndexLocation = RenderBackend::getCurrent().GetUniformLocation(variant.program, "materialIndex");
+            variant.ready = true;
+            return variant;
+        }
+
+        //compile the vertex shader
+        RenderBackend& backend = RenderBackend::getCurrent();
         const GLchar* vertexShaderString = v.c_str();
-        GLuint vertexShader;
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
-        glCompileShader(vertexShader);
-        //check compilation status
-        shaderCompileLog(vertexShader);
+        variant.vertexShader = backend.CreateShader(GL_VERTEX_SHADER);
+        backend.ShaderSource(variant.vertexShader, 1, &vertexShaderString, NULL);
+        backend.CompileShader(variant.vertexShader);
         
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
+        //compile the fragment shader
         const GLchar* fragmentShaderString = f.c_str();
-        GLuint fragmentShader;
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
-        glCompileShader(fragmentShader);
-        //check compilation status
-        shaderCompileLog(fragmentShader);
+        variant.fragmentShader = backend.CreateShader(GL_FRAGMENT_SHADER);
+        backend.ShaderSource(variant.fragmentShader, 1, &fragmentShaderString, NULL);
+        backend.CompileShader(variant.fragmentShader);
         
-        //attach and link the shader programs
-        this->shaderProgram = glCreateProgram();
-        glAttachShader(this->shaderProgram, vertexShader);
-        glAttachShader(this->shaderProgram, fragmentShader);
-        glLinkProgram(this->shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        //check linking info
-        shaderLinkLog(this->shaderProgram);
+        //attach and link the shader programs, the status is checked once the driver is done
+        variant.program = backend.CreateProgram();
+        backend.ProgramParameteri(variant.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        backend.AttachShader(variant.program, variant.vertexShader);
+        backend.AttachShader(variant.program, variant.fragmentShader);
+        backend.LinkProgram(variant.program);
+
+        return variant;
+    }
+
+    bool Shader::isCompleted(const Variant& variant) {
+
+#if not defined (__APPLE__)
+        if (parallelCompile) {
+            GLint completed = GL_FALSE;
+            RenderBackend::getCurrent().GetProgramiv(variant.program, GL_COMPLETION_STATUS_KHR, &completed);
+            return completed == GL_TRUE;
+        }
+#endif
+        return true;
+    }
+
+    void Shader::finishVariant(Variant& variant) {
+
+        //check compilation and linking info
+        bool compiled = shaderCompileLog(variant.vertexShader);
+        compiled = shaderCompileLog(variant.fragmentShader) && compiled;
+        bool linked = compiled && shaderLinkLog(variant.program);
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.DeleteShader(variant.vertexShader);
+        backend.DeleteShader(variant.fragmentShader);
+        variant.vertexShader = 0;
+        variant.fragmentShader = 0;
+
+        if (linked) {
+            ProgramCache::getInstance().Store(variant.cacheKey, variant.program);
+            variant.materialIndexLocation = backend.GetUniformLocation(variant.program, "materialIndex");
+        }
+
+        variant.ready = true;
+        variant.failed = !linked;
+    }
+
+    void Shader::setDefines(const std::string& defines) {
+
+        sourceDefines = defines;
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+
+        //read the sources once, every variant is built from them
+        vertexSource = readShaderFile(vertexShaderFileName);
+        fragmentSource = readShaderFile(fragmentShaderFileName);
+
+        variants.clear();
+        currentVariant = 0;
+
+        //the plain variant is always usable, it stands in for the ones still compiling
+        Variant& plain = submitVariant(0);
+        if (!plain.ready) {
+            finishVariant(plain);
+        }
+        this->shaderProgram = plain.program;
+        this->materialIndexLocation = plain.materialIndexLocation;
     }
     
     void Shader::useShaderProgram() {
 
-        glUseProgram(this->shaderProgram);
+        RenderBackend::getCurrent().UseProgram(this->shaderProgram);
+    }
+
+    void Shader::submitVariants(const std::vector<unsigned int>& featureSets) {
+
+        //without parallel compile every submit would compile and link right here, useVariant builds them on first use instead
+        if (!parallelCompile) {
+            return;
+        }
+
+        for (size_t i = 0; i < featureSets.size(); i++) {
+            submitVariant(featureSets[i]);
+        }
+    }
+
+    bool Shader::useVariant(unsigned int features) {
+
+        Variant& variant = submitVariant(features);
+        if (!variant.ready && isCompleted(variant)) {
+            finishVariant(variant);
+        }
+
+        bool usable = variant.ready && !variant.failed;
+
+        currentVariant = features;
+        const Variant& bound = usable ? variant : variants[0];
+        this->shaderProgram = bound.program;
+        this->materialIndexLocation = bound.materialIndexLocation;
+        RenderBackend::getCurrent().UseProgram(this->shaderProgram);
+
+        return usable;
+    }
+
+    unsigned int Shader::getVariant() {
+
+        return currentVariant;
+    }
+
+    GLint Shader::getMaterialIndexLocation() {
+
+        return materialIndexLocation;
+    }
+
+    void Shader::pollVariants() {
+
+        //without parallel compile any status query would block
+        if (!parallelCompile) {
+            return;
+        }
+
+        for (std::unordered_map<unsigned int, Variant>::iterator it = variants.begin(); it != variants.end(); ++it) {
+
+            if (!it->second.ready && isCompleted(it->second)) {
+                finishVariant(it->second);
+            }
+        }
+    }
+
+    int Shader::getPendingCount() {
+
+        int pending = 0;
+        for (std::unordered_map<unsigned int, Variant>::iterator it = variants.begin(); it != variants.end(); ++it) {
+
+            if (!it->second.ready) {
+                pending++;
+            }
+        }
+        return pending;
+    }
+
+    bool Shader::initParallelCompile() {
+
+#if not defined (__APPLE__)
+        //0xFFFFFFFF lets the implementation pick the number of compiler threads
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallelCompile = true;
+        }
+        else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            parallelCompile = true;
+        }
+#endif
+        return parallelCompile;
     }
 
 }
@@ -20,21 +20,83 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 
 namespace gps {
+
+    // compile time features, each bit injects a #define right after the #version line
+    enum ShaderFeature {
+        SHADER_FLASH     = 1 << 0,
+        SHADER_GREY      = 1 << 1,
+        SHADER_FOG       = 1 << 2,
+        SHADER_SHADOWS   = 1 << 3,
+        SHADER_INSTANCED = 1 << 4,
+        SHADER_CLUSTERED = 1 << 5
+    };
     
     class Shader {
 
     public:
+        // program bound by the last useVariant(), the one without features after loadShader
         GLuint shaderProgram;
+        // extra #define lines for every variant, the plain one included, set before loadShader
+        void setDefines(const std::string& defines);
+        // builds the variant without features right away, it is the fallback for all others
         void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
         void useShaderProgram();
+        // starts compiling the variants without waiting for the driver to finish,
+        // nothing without parallel compile, the variants are then built on their first use
+        void submitVariants(const std::vector<unsigned int>& featureSets);
+        // binds the variant built with the given ShaderFeature bits, submitting it on first use
+        // while it is still compiling the plain variant is bound instead and false is returned
+        bool useVariant(unsigned int features);
+        unsigned int getVariant();
+        // location of materialIndex in the bound program, -1 when it does not read the uniform
+        GLint getMaterialIndexLocation();
+        // finishes the variants whose compilation completed, never waits for the driver
+        void pollVariants();
+        int getPendingCount();
+
+        // lets the driver compile on its own threads when GL_KHR_parallel_shader_compile is there
+        static bool initParallelCompile();
     
     private:
+        struct Variant {
+            GLuint program;
+            // kept until linking finished, for the error log
+            GLuint vertexShader;
+            GLuint fragmentShader;
+            std::string cacheKey;
+            // looked up once the program is linked, per draw uniforms are set through it
+            GLint materialIndexLocation;
+            bool ready;
+            bool failed;
+        };
+
+        std::string vertexSource;
+        std::string fragmentSource;
+        std::string sourceDefines;
+        // programs by feature bitmask
+        std::unordered_map<unsigned int, Variant> variants;
+        unsigned int currentVariant = 0;
+        GLint materialIndexLocation = -1;
+
+        static bool parallelCompile;
+
         std::string readShaderFile(std::string fileName);
-        void shaderCompileLog(GLuint shaderId);
-        void shaderLinkLog(GLuint shaderProgramId);
+        std::string injectDefines(const std::string& source, unsigned int features);
+        // compiles and links without querying any status, see finishVariant()
+        Variant& submitVariant(unsigned int features);
+        // asks the driver without blocking, always true when compiling is not parallel
+        bool isCompleted(const Variant& variant);
+        void finishVariant(Variant& variant);
+        // returns false when compilation failed
+        bool shaderCompileLog(GLuint shaderId);
+        // returns false when linking failed
+        bool shaderLinkLog(GLuint shaderProgramId);
     };
     
 }
@@ -7,9 +7,176 @@
 //
 
 #include "SkyBox.hpp"
+#include "Hash.hpp"
+#include "RenderBackend.hpp"
+#include "SphericalHarmonics.hpp"
+#include "TextureManager.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
 
 namespace gps {
 
+    namespace {
+
+        // RGBA8 face with its mips, the colour filtered in linear light
+        struct FaceImage {
+            std::vector<std::vector<unsigned char> > levels;
+            int width;
+            int height;
+        };
+
+        FaceImage DecodeFace(const GLchar* faceName)
+        {
+            FaceImage face;
+            int n;
+            int force_channels = 4;
+            unsigned char* image_data = stbi_load(faceName, &face.width, &face.height, &n, force_channels);
+            if (image_data) {
+                buildMipLevels(image_data, face.width, face.height, 4, true, face.levels);
+                stbi_image_free(image_data);
+            }
+            return face;
+        }
+
+        // parallel spreads the faces over the workers, a task on the pool decodes them itself
+        // as waiting on tasks queued behind it could leave every worker waiting
+        std::vector<FaceImage> DecodeFaces(const std::vector<const GLchar*>& skyBoxFaces, bool parallel)
+        {
+            std::vector<FaceImage> faces;
+            if (parallel) {
+                std::vector<std::future<FaceImage> > decoding;
+                for (GLuint i = 0; i < skyBoxFaces.size(); i++)
+                {
+                    const GLchar* faceName = skyBoxFaces[i];
+                    decoding.push_back(ThreadPool::getShared().Submit([faceName]() { return DecodeFace(faceName); }));
+                }
+                for (GLuint i = 0; i < decoding.size(); i++)
+                {
+                    faces.push_back(decoding[i].get());
+                }
+            }
+            else {
+                for (GLuint i = 0; i < skyBoxFaces.size(); i++)
+                {
+                    faces.push_back(DecodeFace(skyBoxFaces[i]));
+                }
+            }
+
+            //a cube map needs six square faces of one size
+            for (GLuint i = 0; i < faces.size(); i++)
+            {
+                if (faces[i].levels.empty()) {
+                    fprintf(stderr, "ERROR: could not load %s\n", skyBoxFaces[i]);
+                    return std::vector<FaceImage>();
+                }
+                if (faces.size() != 6 || faces[i].width != faces[i].height || faces[i].width != faces[0].width) {
+                    fprintf(stderr, "ERROR: %s is not a square face of the size of the others\n", skyBoxFaces[i]);
+                    return std::vector<FaceImage>();
+                }
+            }
+            return faces;
+        }
+
+        // one stamp for the six faces, any of them changing makes the cache stale
+        bool getFacesStamp(const std::vector<const GLchar*>& skyBoxFaces, SourceStamp& stamp)
+        {
+            stamp.size = 0;
+            stamp.modified = 0;
+            stamp.contentHash = HASH_SEED;
+            for (GLuint i = 0; i < skyBoxFaces.size(); i++)
+            {
+                SourceStamp face;
+                if (!getSourceStamp(skyBoxFaces[i], face)) {
+                    return false;
+                }
+                stamp.size += face.size;
+                stamp.modified = std::max(stamp.modified, face.modified);
+                stamp.contentHash = hashString(skyBoxFaces[i], stamp.contentHash);
+                stamp.contentHash = hashBytes(&face.size, sizeof(face.size), stamp.contentHash);
+                stamp.contentHash = hashBytes(&face.modified, sizeof(face.modified), stamp.contentHash);
+            }
+            return true;
+        }
+
+        // the cache when it is up to date, otherwise the faces are decoded and compressed, on the workers
+        // when parallel, and handed back in decoded, which stays empty on a cache hit
+        bool readCompressed(const std::vector<const GLchar*>& cubeMapFaces, bool parallel, MipChain& chain, bool& fromCache, std::vector<FaceImage>& decoded)
+        {
+            SourceStamp source;
+            fromCache = false;
+            if (!getFacesStamp(cubeMapFaces, source)) {
+                return false;
+            }
+
+            SourceStamp cached;
+            if (readKTX2(SkyBox::getCachePath(cubeMapFaces), chain, cached) && chain.faces == 6
+                && cached.size == source.size && cached.modified == source.modified && cached.contentHash == source.contentHash) {
+                fromCache = true;
+                return true;
+            }
+
+            decoded = DecodeFaces(cubeMapFaces, parallel);
+            const std::vector<FaceImage>& faces = decoded;
+            if (faces.empty()) {
+                return false;
+            }
+
+            //one format for every face, BC3 only when one of them has alpha
+            chain.format = BLOCK_BC1_SRGB;
+            for (GLuint i = 0; i < faces.size(); i++)
+            {
+                if (chooseBlockFormat(faces[i].levels[0].data(), faces[i].width, faces[i].height, true) == BLOCK_BC3_SRGB)
+                    chain.format = BLOCK_BC3_SRGB;
+            }
+            chain.width = faces[0].width;
+            chain.height = faces[0].height;
+            chain.faces = 6;
+
+            //every face of every level is a separate job
+            int levelCount = (int)faces[0].levels.size();
+            std::vector<std::vector<unsigned char> > blocks(levelCount * 6);
+            std::function<void(int, int)> compressBlocks = [&faces, &blocks, &chain](int begin, int end) {
+                for (int i = begin; i < end; i++) {
+                    int level = i / 6;
+                    const FaceImage& face = faces[i % 6];
+                    blocks[i] = compressLevel(face.levels[level].data(), std::max(1, face.width >> level), std::max(1, face.height >> level), chain.format);
+                }
+            };
+            if (parallel)
+                ThreadPool::getShared().ParallelFor((int)blocks.size(), compressBlocks);
+            else
+                compressBlocks(0, (int)blocks.size());
+
+            chain.levels.assign(levelCount, std::vector<unsigned char>());
+            for (size_t i = 0; i < blocks.size(); i++)
+            {
+                std::vector<unsigned char>& level = chain.levels[i / 6];
+                level.insert(level.end(), blocks[i].begin(), blocks[i].end());
+            }
+
+            if (!writeKTX2(SkyBox::getCachePath(cubeMapFaces), chain, source)) {
+                fprintf(stderr, "WARNING: could not write the cube map cache %s\n", SkyBox::getCachePath(cubeMapFaces).c_str());
+            }
+            return true;
+        }
+    }
+
+    struct SkyBox::CubeMapData {
+        // block compressed faces, or RGBA8 ones when the driver has no S3TC
+        MipChain chain;
+        std::vector<FaceImage> faces;
+        bool compressed;
+        bool fromCache;
+        int size;
+        int levelCount;
+        double loadMs;
+        float ambient[SH_FLOAT_COUNT];
+    };
+
     SkyBox::SkyBox()
     {
 
@@ -17,62 +184,403 @@ namespace gps {
 
     void SkyBox::Load(std::vector<const GLchar*> cubeMapFaces)
     {
-        cubemapTexture = LoadSkyBoxTextures(cubeMapFaces);
-        InitSkyBox();
+        int index = Add(cubeMapFaces);
+        CubeMap& cubeMap = cubeMaps[index];
+        cubeMap.data = ReadCubeMap(cubeMap.faces, TextureManager::getInstance().isCompressionEnabled(), true);
+        if (cubeMap.data) {
+            UploadFaces(cubeMap, SIZE_MAX);
+            SwitchTo(index, 0.0f);
+        }
     }
 
-    void SkyBox::Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    void SkyBox::Draw(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
     {
+        if (current < 0) {
+            return;
+        }
+
+        RenderBackend& backend = RenderBackend::getCurrent();
         shader.useShaderProgram();
+        const UniformHandles& handles = getHandles(cubeHandles, shader.shaderProgram);
 
         //set the view and projection matrices
         glm::mat4 transformedView = glm::mat4(glm::mat3(viewMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        backend.UniformMatrix4fv(handles.view, 1, GL_FALSE, glm::value_ptr(transformedView));
+        backend.UniformMatrix4fv(handles.projection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+
+        backend.DepthFunc(GL_LEQUAL);
+
+        backend.BindVertexArray(skyboxVAO);
+        BindCubeMaps(handles);
+        backend.DrawArrays(GL_TRIANGLES, 0, 36);
+        backend.BindVertexArray(0);
+
+        backend.DepthFunc(GL_LESS);
+    }
+
+    void SkyBox::DrawFullscreen(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    {
+        if (current < 0) {
+            return;
+        }
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        shader.useShaderProgram();
+        const UniformHandles& handles = getHandles(triangleHandles, shader.shaderProgram);
+
+        //rays from the camera, the translation is dropped like in the cube path
+        glm::mat4 inverseViewProjection = glm::inverse(projectionMatrix * glm::mat4(glm::mat3(viewMatrix)));
+        backend.UniformMatrix4fv(handles.inverseViewProjection, 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+
+        //the triangle sits exactly at depth 1, the cleared value, and never writes depth
+        backend.DepthFunc(GL_EQUAL);
+        backend.DepthMask(GL_FALSE);
+
+        backend.BindVertexArray(triangleVAO);
+        BindCubeMaps(handles);
+        backend.DrawArrays(GL_TRIANGLES, 0, 3);
+        backend.BindVertexArray(0);
+
+        backend.DepthMask(GL_TRUE);
+        backend.DepthFunc(GL_LESS);
+    }
+
+    const SkyBox::UniformHandles& SkyBox::getHandles(UniformHandles& handles, GLuint program)
+    {
+        RenderBackend& backend = RenderBackend::getCurrent();
+        if (handles.program != program) {
+            handles.program = program;
+            handles.view = backend.GetUniformLocation(program, "view");
+            handles.projection = backend.GetUniformLocation(program, "projection");
+            handles.inverseViewProjection = backend.GetUniformLocation(program, "inverseViewProjection");
+            handles.blend = backend.GetUniformLocation(program, "blend");
+            backend.Uniform1i(backend.GetUniformLocation(program, "skybox"), 0);
+            backend.Uniform1i(backend.GetUniformLocation(program, "previousSkybox"), 1);
+        }
+        return handles;
+    }
+
+    void SkyBox::BindCubeMaps(const UniformHandles& handles)
+    {
+        RenderBackend& backend = RenderBackend::getCurrent();
+        //outside a fade both units hold the same cube map
+        int faded = previous >= 0 ? previous : current;
+        backend.ActiveTexture(GL_TEXTURE0);
+        backend.BindTexture(GL_TEXTURE_CUBE_MAP, cubeMaps[current].texture);
+        backend.ActiveTexture(GL_TEXTURE1);
+        backend.BindTexture(GL_TEXTURE_CUBE_MAP, cubeMaps[faded].texture);
+        backend.ActiveTexture(GL_TEXTURE0);
+        backend.Uniform1f(handles.blend, blend);
+    }
+
+    int SkyBox::Add(const std::vector<const GLchar*>& cubeMapFaces)
+    {
+        if (skyboxVAO == 0) {
+            InitSkyBox();
+        }
 
-        glDepthFunc(GL_LEQUAL);
+        CubeMap cubeMap;
+        cubeMap.faces.assign(cubeMapFaces.begin(), cubeMapFaces.end());
+        cubeMaps.push_back(cubeMap);
+        return (int)cubeMaps.size() - 1;
+    }
 
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glUniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+    void SkyBox::Preload(int index)
+    {
+        if (index < 0 || index >= (int)cubeMaps.size()) {
+            return;
+        }
+
+        CubeMap& cubeMap = cubeMaps[index];
+        cubeMap.lastUsed = time;
+        if (cubeMap.loaded || cubeMap.data || cubeMap.loading.valid()) {
+            return;
+        }
 
-        glDepthFunc(GL_LESS);
+        std::vector<std::string> faces = cubeMap.faces;
+        bool compress = TextureManager::getInstance().isCompressionEnabled();
+        //one task for the whole cube map, it must not wait on the pool it runs on
+        cubeMap.loading = ThreadPool::getShared().Submit([faces, compress]() { return ReadCubeMap(faces, compress, false); }).share();
     }
 
-    GLuint SkyBox::LoadSkyBoxTextures(std::vector<const GLchar*> skyBoxFaces)
+    void SkyBox::Select(int index, float seconds)
     {
-        GLuint textureID;
-        glGenTextures(1, &textureID);
-        glActiveTexture(GL_TEXTURE0);
+        if (index < 0 || index >= (int)cubeMaps.size() || index == current) {
+            target = -1;
+            return;
+        }
+
+        if (cubeMaps[index].loaded) {
+            SwitchTo(index, seconds);
+            return;
+        }
+
+        //the fade starts in Update once the upload is done
+        Preload(index);
+        target = index;
+        fadeSeconds = seconds;
+    }
 
-        int width, height, n;
-        unsigned char* image;
-        int force_channels = 3;
+    void SkyBox::SwitchTo(int index, float seconds)
+    {
+        previous = current >= 0 && seconds > 0.0f ? current : -1;
+        current = index;
+        target = -1;
+        fadeSeconds = seconds;
+        fadeStart = time;
+        blend = previous >= 0 ? 0.0f : 1.0f;
+        cubeMaps[index].lastUsed = time;
+        BlendAmbient();
+    }
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-        for (GLuint i = 0; i < skyBoxFaces.size(); i++)
+    void SkyBox::BlendAmbient()
+    {
+        //the lighting follows the crossfade of the sky
+        const float* to = cubeMaps[current].ambient;
+        const float* from = previous >= 0 ? cubeMaps[previous].ambient : to;
+        for (int i = 0; i < SH_FLOAT_COUNT; i++) {
+            ambient[i] = from[i] + (to[i] - from[i]) * blend;
+        }
+    }
+
+    void SkyBox::Update(double now)
+    {
+        time = now;
+
+        //one cube map uploads at a time, the selected one first
+        size_t budget = UPLOAD_BYTES_PER_FRAME;
+        int uploading = target >= 0 && !cubeMaps[target].loaded ? target : -1;
+        for (size_t i = 0; i < cubeMaps.size() && uploading < 0; i++) {
+            if (!cubeMaps[i].loaded && (cubeMaps[i].data || cubeMaps[i].loading.valid()))
+                uploading = (int)i;
+        }
+        if (uploading >= 0) {
+            CubeMap& cubeMap = cubeMaps[uploading];
+            if (!cubeMap.data && cubeMap.loading.valid() && cubeMap.loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                cubeMap.data = cubeMap.loading.get();
+                cubeMap.loading = std::shared_future<std::shared_ptr<CubeMapData> >();
+                if (!cubeMap.data && uploading == target) {
+                    target = -1;
+                }
+            }
+            if (cubeMap.data) {
+                UploadFaces(cubeMap, budget);
+            }
+        }
+
+        if (target >= 0 && cubeMaps[target].loaded) {
+            SwitchTo(target, fadeSeconds);
+        }
+
+        if (previous >= 0) {
+            blend = (float)std::min(1.0, (time - fadeStart) / fadeSeconds);
+            if (blend >= 1.0f) {
+                previous = -1;
+            }
+            BlendAmbient();
+        }
+
+        //whatever is drawn or about to be stays, the rest goes after a while
+        for (size_t i = 0; i < cubeMaps.size(); i++) {
+            CubeMap& cubeMap = cubeMaps[i];
+            int index = (int)i;
+            if (index == current || index == previous || index == target) {
+                cubeMap.lastUsed = time;
+            }
+            else if ((cubeMap.loaded || cubeMap.data) && time - cubeMap.lastUsed > IDLE_UNLOAD_SECONDS) {
+                std::cout << "Skybox " << cubeMap.faces[0] << " unloaded after " << IDLE_UNLOAD_SECONDS << " s unused" << std::endl;
+                Unload(cubeMap);
+            }
+        }
+    }
+
+    void SkyBox::Unload(CubeMap& cubeMap)
+    {
+        if (cubeMap.texture != 0) {
+            RenderBackend::getCurrent().DeleteTextures(1, &cubeMap.texture);
+        }
+        cubeMap.texture = 0;
+        cubeMap.bytes = 0;
+        cubeMap.data.reset();
+        cubeMap.uploadCursor = 0;
+        cubeMap.loaded = false;
+    }
+
+    void SkyBox::Delete()
+    {
+        for (size_t i = 0; i < cubeMaps.size(); i++) {
+            Unload(cubeMaps[i]);
+        }
+        cubeMaps.clear();
+        current = -1;
+        previous = -1;
+        target = -1;
+        if (skyboxVAO != 0) {
+            RenderBackend& backend = RenderBackend::getCurrent();
+            backend.DeleteVertexArrays(1, &skyboxVAO);
+            backend.DeleteVertexArrays(1, &triangleVAO);
+            backend.DeleteBuffers(1, &skyboxVBO);
+        }
+        skyboxVAO = 0;
+        triangleVAO = 0;
+        skyboxVBO = 0;
+        cubeHandles = UniformHandles();
+        triangleHandles = UniformHandles();
+    }
+
+    int SkyBox::getSelected()
+    {
+        return target >= 0 ? target : current;
+    }
+
+    bool SkyBox::isLoaded(int index)
+    {
+        return index >= 0 && index < (int)cubeMaps.size() && cubeMaps[index].loaded;
+    }
+
+    int SkyBox::getCount()
+    {
+        return (int)cubeMaps.size();
+    }
+
+    std::string SkyBox::getCachePath(const std::vector<const GLchar*>& cubeMapFaces)
+    {
+        std::string firstFace = cubeMapFaces.empty() ? std::string() : cubeMapFaces[0];
+        return firstFace + ".cube.ktx2";
+    }
+
+    std::string SkyBox::getAmbientPath(const std::vector<const GLchar*>& cubeMapFaces)
+    {
+        std::string firstFace = cubeMapFaces.empty() ? std::string() : cubeMapFaces[0];
+        return firstFace + ".sh9";
+    }
+
+    bool SkyBox::BuildCache(const std::vector<const GLchar*>& cubeMapFaces)
+    {
+        std::vector<std::string> faces(cubeMapFaces.begin(), cubeMapFaces.end());
+        return ReadCubeMap(faces, true, true) != NULL;
+    }
+
+    std::shared_ptr<SkyBox::CubeMapData> SkyBox::ReadCubeMap(const std::vector<std::string>& cubeMapFaces, bool compress, bool parallel)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::vector<const GLchar*> skyBoxFaces;
+        for (size_t i = 0; i < cubeMapFaces.size(); i++)
         {
-            image = stbi_load(skyBoxFaces[i], &width, &height, &n, force_channels);
-            if (!image) {
-                fprintf(stderr, "ERROR: could not load %s\n", skyBoxFaces[i]);
-                return false;
+            skyBoxFaces.push_back(cubeMapFaces[i].c_str());
+        }
+
+        //block compressed from the cache, or RGBA8 faces with their mips when the driver has no S3TC
+        std::shared_ptr<CubeMapData> data = std::make_shared<CubeMapData>();
+        std::vector<FaceImage> decoded;
+        data->compressed = compress;
+        data->fromCache = false;
+        if (compress) {
+            if (!readCompressed(skyBoxFaces, parallel, data->chain, data->fromCache, decoded)) {
+                return std::shared_ptr<CubeMapData>();
+            }
+            data->size = data->chain.width;
+            data->levelCount = (int)data->chain.levels.size();
+        }
+        else {
+            data->faces = DecodeFaces(skyBoxFaces, parallel);
+            if (data->faces.empty()) {
+                return std::shared_ptr<CubeMapData>();
+            }
+            data->size = data->faces[0].width;
+            data->levelCount = (int)data->faces[0].levels.size();
+        }
+
+        //the ambient of the faces is cached beside them, projecting it needs the decoded level 0
+        SourceStamp source;
+        std::string ambientPath = getAmbientPath(skyBoxFaces);
+        bool stamped = getFacesStamp(skyBoxFaces, source);
+        if (!stamped || !readAmbientSH(ambientPath, source, data->ambient)) {
+            //only a compressed cache hit has no faces at hand
+            std::vector<FaceImage>& faces = compress ? decoded : data->faces;
+            if (faces.empty()) {
+                faces = DecodeFaces(skyBoxFaces, parallel);
+                if (faces.empty()) {
+                    return std::shared_ptr<CubeMapData>();
+                }
+            }
+            const unsigned char* levels[6];
+            for (int i = 0; i < 6; i++) {
+                levels[i] = faces[i].levels[0].data();
+            }
+            projectCubeMap(levels, data->size, data->ambient, parallel);
+            if (stamped && !writeAmbientSH(ambientPath, source, data->ambient)) {
+                fprintf(stderr, "WARNING: could not write the skybox ambient %s\n", ambientPath.c_str());
             }
-            glTexImage2D(
-                GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
-                GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image
-            );
         }
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-        return textureID;
+        data->loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return data;
+    }
+
+    bool SkyBox::UploadFaces(CubeMap& cubeMap, size_t budget)
+    {
+        RenderBackend& backend = RenderBackend::getCurrent();
+        const CubeMapData& data = *cubeMap.data;
+
+        if (cubeMap.texture == 0) {
+            backend.GenTextures(1, &cubeMap.texture);
+            backend.BindTexture(GL_TEXTURE_CUBE_MAP, cubeMap.texture);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+            backend.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, data.levelCount - 1);
+            cubeMap.bytes = 0;
+        }
+
+        backend.BindTexture(GL_TEXTURE_CUBE_MAP, cubeMap.texture);
+        size_t uploaded = 0;
+        int faceCount = data.levelCount * 6;
+        while (cubeMap.uploadCursor < faceCount && uploaded < budget)
+        {
+            int level = cubeMap.uploadCursor / 6;
+            GLuint i = cubeMap.uploadCursor % 6;
+            GLsizei levelSize = std::max(1, data.size >> level);
+            size_t faceBytes;
+            if (data.compressed) {
+                faceBytes = data.chain.levels[level].size() / 6;
+                backend.CompressedTexImage2D(
+                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level,
+                    getBlockInternalFormat(data.chain.format), levelSize, levelSize, 0, (GLsizei)faceBytes, data.chain.levels[level].data() + faceBytes * i
+                );
+            }
+            else {
+                faceBytes = data.faces[i].levels[level].size();
+                backend.TexImage2D(
+                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level,
+                    GL_SRGB8_ALPHA8, levelSize, levelSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.faces[i].levels[level].data()
+                );
+            }
+            uploaded += faceBytes;
+            cubeMap.bytes += faceBytes;
+            cubeMap.uploadCursor++;
+        }
+        backend.BindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        if (cubeMap.uploadCursor < faceCount) {
+            return false;
+        }
+
+        //RGB8 level 0 only is what the faces used to cost, the drivers pad it to 4 bytes
+        size_t rgbBytes = (size_t)data.size * data.size * 4 * 6;
+        std::cout << "Skybox " << cubeMap.faces[0] << ": 6x" << data.size << "x" << data.size << ", "
+            << (data.compressed ? (getBlockBytes(data.chain.format) == 16 ? "BC3" : "BC1") : "RGBA8") << " sRGB, " << data.levelCount << " levels, "
+            << rgbBytes / 1024 << " KB -> " << cubeMap.bytes / 1024.0 << " KB, "
+            << (data.compressed ? (data.fromCache ? "from the cache" : "cache built") : "decoded") << " in " << data.loadMs << " ms" << std::endl;
+
+        std::copy(data.ambient, data.ambient + SH_FLOAT_COUNT, cubeMap.ambient);
+        cubeMap.data.reset();
+        cubeMap.loaded = true;
+        return true;
     }
 
     void SkyBox::InitSkyBox()
@@ -121,21 +629,39 @@ namespace gps {
             1.0f, -1.0f,  1.0f
         };
 
-        glGenVertexArrays(1, &(this->skyboxVAO));
-        glGenBuffers(1, &skyboxVBO);
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.GenVertexArrays(1, &(this->skyboxVAO));
+        backend.GenBuffers(1, &skyboxVBO);
+
+        backend.BindVertexArray(skyboxVAO);
+        backend.BindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+        backend.BufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
 
-        glBindVertexArray(skyboxVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        backend.EnableVertexAttribArray(0);
+        backend.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+        backend.BindVertexArray(0);
 
-        glBindVertexArray(0);
+        //core profiles draw nothing without a VAO, even with no attributes
+        backend.GenVertexArrays(1, &triangleVAO);
     }
 
     GLuint SkyBox::GetTextureId()
     {
-        return cubemapTexture;
+        return current >= 0 ? cubeMaps[current].texture : 0;
+    }
+
+    const float* SkyBox::getAmbient()
+    {
+        return ambient;
+    }
+
+    size_t SkyBox::getBytes()
+    {
+        size_t bytes = 0;
+        for (size_t i = 0; i < cubeMaps.size(); i++) {
+            bytes += cubeMaps[i].bytes;
+        }
+        return bytes;
     }
 }
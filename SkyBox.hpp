@@ -11,24 +11,118 @@
 
 #include <stdio.h>
 #include "Shader.hpp"
+#include "SphericalHarmonics.hpp"
+#include "TextureCodec.hpp"
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 #include "stb_image.h"
 #include "glm/glm.hpp"	
 #include "glm/gtc/type_ptr.hpp"
 
 namespace gps {
+
+    // A set of cube maps, one of them drawn at a time.
+    // The others load in the background: their faces decode on the workers and Update uploads
+    // a few faces per frame, so switching never stalls a frame. A switch fades from the old cube
+    // map to the new one, and cube maps unused for IDLE_UNLOAD_SECONDS are unloaded again.
     class SkyBox
     {
     public:
+        // compressed bytes uploaded per Update, at least one face goes every frame
+        static const size_t UPLOAD_BYTES_PER_FRAME = 256 * 1024;
+        static const int IDLE_UNLOAD_SECONDS = 60;
+
         SkyBox();
+        // adds the cube map and loads it right away, it is the one drawn
         void Load(std::vector<const GLchar*> cubeMapFaces);
-        void Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        void Draw(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        // one fullscreen triangle on the far plane instead of the cube, drawn with GL_EQUAL so only
+        // the pixels the scene did not cover run the shader, needs the skyboxTriangle shaders
+        void DrawFullscreen(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
         GLuint GetTextureId();
+        // video memory of the loaded cube maps, every face and level included
+        size_t getBytes();
+        // diffuse ambient of the drawn cube map as spherical harmonics, blended during a fade
+        const float* getAmbient();
+
+        // registers a cube map without loading it, returns its index
+        int Add(const std::vector<const GLchar*>& cubeMapFaces);
+        // starts loading the cube map in the background, nothing when it is loaded or loading
+        void Preload(int index);
+        // fades to the cube map over fadeSeconds once it is loaded, loading it first when needed
+        void Select(int index, float fadeSeconds);
+        // uploads the finished decodes, advances the fade and unloads idle cube maps, once per frame
+        void Update(double time);
+        void Delete();
+
+        int getSelected();
+        bool isLoaded(int index);
+        int getCount();
+
+        // KTX2 cube map with the block compressed faces and their mips, next to the first face
+        static std::string getCachePath(const std::vector<const GLchar*>& cubeMapFaces);
+        // spherical harmonics of the faces, next to the first face
+        static std::string getAmbientPath(const std::vector<const GLchar*>& cubeMapFaces);
+        // writes the caches when they are missing or older than the faces, needs no GL context
+        static bool BuildCache(const std::vector<const GLchar*>& cubeMapFaces);
     private:
-        GLuint skyboxVAO;
-        GLuint skyboxVBO;
-        GLuint cubemapTexture;
-        GLuint LoadSkyBoxTextures(std::vector<const GLchar*> cubeMapFaces);
+        // decoded faces waiting for their upload, defined with the loading code
+        struct CubeMapData;
+
+        struct CubeMap {
+            std::vector<std::string> faces;
+            GLuint texture = 0;
+            size_t bytes = 0;
+            std::shared_future<std::shared_ptr<CubeMapData> > loading;
+            std::shared_ptr<CubeMapData> data;
+            // next face to upload, levels in order and the 6 faces of each
+            int uploadCursor = 0;
+            bool loaded = false;
+            double lastUsed = 0.0;
+            float ambient[SH_FLOAT_COUNT];
+        };
+
+        // uniform locations of a skybox program, looked up again when the program is rebuilt
+        struct UniformHandles {
+            GLuint program = 0;
+            GLint view;
+            GLint projection;
+            GLint inverseViewProjection;
+            GLint blend;
+        };
+
+        GLuint skyboxVAO = 0;
+        GLuint skyboxVBO = 0;
+        // attributeless VAO for the fullscreen triangle
+        GLuint triangleVAO = 0;
+        UniformHandles cubeHandles;
+        UniformHandles triangleHandles;
+        std::vector<CubeMap> cubeMaps;
+        // drawn, faded from and waiting to be faded to, -1 when none
+        int current = -1;
+        int previous = -1;
+        int target = -1;
+        float fadeSeconds = 0.0f;
+        double fadeStart = 0.0;
+        float blend = 1.0f;
+        double time = 0.0;
+        // no light until a cube map is loaded
+        float ambient[SH_FLOAT_COUNT] = { 0.0f };
+
+        // decodes the faces, or reads the compressed cache, safe to run on any thread
+        // parallel splits the work over the shared pool, false keeps it on the calling thread for tasks on that pool
+        static std::shared_ptr<CubeMapData> ReadCubeMap(const std::vector<std::string>& cubeMapFaces, bool compress, bool parallel);
+        // uploads faces until the budget is spent, true once the cube map is complete
+        bool UploadFaces(CubeMap& cubeMap, size_t budget);
+        void SwitchTo(int index, float seconds);
+        void BlendAmbient();
+        // with the program in use, sets the sampler units on a lookup
+        static const UniformHandles& getHandles(UniformHandles& handles, GLuint program);
+        // current cube map on unit 0, the faded one on unit 1
+        void BindCubeMaps(const UniformHandles& handles);
+        void Unload(CubeMap& cubeMap);
         void InitSkyBox();
     };
 }
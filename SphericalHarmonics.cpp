@@ -0,0 +1,223 @@
+#include "SphericalHarmonics.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TEXTURE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const char* AMBIENT_HEADER = "gpsAmbientSH";
+        // bumped when the projection changes so older files are rebuilt
+        const unsigned int AMBIENT_VERSION = 1;
+
+        // basis constants, and the cosine lobe over pi per band
+        const float BASIS[SH_COEFFICIENT_COUNT] = {
+            0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f
+        };
+        const float LOBE[SH_COEFFICIENT_COUNT] = {
+            1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+        };
+
+        // direction of a face texel as rows of { s, t, 1 } weights for x, y and z, from the GL cube map table
+        const float FACE_AXES[6][3][3] = {
+            { { 0, 0, 1 }, { 0, -1, 0 }, { -1, 0, 0 } },
+            { { 0, 0, -1 }, { 0, -1, 0 }, { 1, 0, 0 } },
+            { { 1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+            { { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+            { { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, 1 } },
+            { { -1, 0, 0 }, { 0, -1, 0 }, { 0, 0, -1 } }
+        };
+
+        struct LinearTable {
+            float values[256];
+        };
+
+        LinearTable buildLinearTable() {
+
+            LinearTable table;
+            for (int i = 0; i < 256; i++) {
+                double c = i / 255.0;
+                table.values[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+            }
+            return table;
+        }
+
+        const float* getLinearTable() {
+
+            static const LinearTable table = buildLinearTable();
+            return table.values;
+        }
+
+        // adds the weighted colour times the 9 basis polynomials, unit direction x, y, z
+        inline void accumulateTexel(float x, float y, float z, float r, float g, float b, double sums[SH_FLOAT_COUNT]) {
+
+            float basis[SH_COEFFICIENT_COUNT] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+            for (int i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+                sums[i * 3] += basis[i] * r;
+                sums[i * 3 + 1] += basis[i] * g;
+                sums[i * 3 + 2] += basis[i] * b;
+            }
+        }
+
+        // one row of one face, the solid angle of each texel weights its colour
+        void projectRow(const unsigned char* row, int size, int face, float t, double sums[SH_FLOAT_COUNT]) {
+
+            const float* linear = getLinearTable();
+            const float (*axes)[3] = FACE_AXES[face];
+            float texelArea = 4.0f / ((float)size * size);
+            float step = 2.0f / size;
+            int x = 0;
+
+#ifdef TEXTURE_SSE2
+            __m128 accumulators[SH_FLOAT_COUNT];
+            for (int i = 0; i < SH_FLOAT_COUNT; i++) {
+                accumulators[i] = _mm_setzero_ps();
+            }
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 three = _mm_set1_ps(3.0f);
+            const __m128 tt = _mm_set1_ps(t);
+            const __m128 area = _mm_set1_ps(texelArea);
+            for (; x + 4 <= size; x += 4) {
+
+                __m128 s = _mm_sub_ps(_mm_mul_ps(_mm_setr_ps(x + 0.5f, x + 1.5f, x + 2.5f, x + 3.5f), _mm_set1_ps(step)), one);
+                __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(one, _mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(tt, tt)))));
+                __m128 weight = _mm_mul_ps(_mm_mul_ps(inverseLength, _mm_mul_ps(inverseLength, inverseLength)), area);
+
+                __m128 direction[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    __m128 d = _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(axes[axis][0])), _mm_set1_ps(axes[axis][1] * t + axes[axis][2]));
+                    direction[axis] = _mm_mul_ps(d, inverseLength);
+                }
+                __m128 dx = direction[0];
+                __m128 dy = direction[1];
+                __m128 dz = direction[2];
+
+                const unsigned char* texels = row + x * 4;
+                __m128 color[3];
+                for (int c = 0; c < 3; c++) {
+                    color[c] = _mm_mul_ps(weight, _mm_setr_ps(linear[texels[c]], linear[texels[4 + c]], linear[texels[8 + c]], linear[texels[12 + c]]));
+                }
+
+                __m128 basis[SH_COEFFICIENT_COUNT] = {
+                    one, dy, dz, dx, _mm_mul_ps(dx, dy), _mm_mul_ps(dy, dz),
+                    _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(dz, dz)), one), _mm_mul_ps(dx, dz),
+                    _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))
+                };
+                for (int i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+                    for (int c = 0; c < 3; c++)
+                        accumulators[i * 3 + c] = _mm_add_ps(accumulators[i * 3 + c], _mm_mul_ps(basis[i], color[c]));
+                }
+            }
+
+            for (int i = 0; i < SH_FLOAT_COUNT; i++) {
+                float lanes[4];
+                _mm_storeu_ps(lanes, accumulators[i]);
+                sums[i] += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+#endif
+
+            for (; x < size; x++) {
+                float s = (x + 0.5f) * step - 1.0f;
+                float inverseLength = 1.0f / sqrtf(1.0f + s * s + t * t);
+                float weight = inverseLength * inverseLength * inverseLength * texelArea;
+                float direction[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    direction[axis] = (axes[axis][0] * s + axes[axis][1] * t + axes[axis][2]) * inverseLength;
+                }
+                const unsigned char* texel = row + x * 4;
+                accumulateTexel(direction[0], direction[1], direction[2],
+                    weight * linear[texel[0]], weight * linear[texel[1]], weight * linear[texel[2]], sums);
+            }
+        }
+    }
+
+    void projectCubeMap(const unsigned char* const faces[6], int size, float coefficients[SH_FLOAT_COUNT], bool parallel) {
+
+        //every row sums on its own, added up in order afterwards so the result does not depend on the threads
+        int rows = 6 * size;
+        std::vector<double> rowSums((size_t)rows * SH_FLOAT_COUNT, 0.0);
+        std::function<void(int, int)> projectRows = [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                int face = i / size;
+                int y = i % size;
+                float t = (y + 0.5f) * 2.0f / size - 1.0f;
+                projectRow(faces[face] + (size_t)y * size * 4, size, face, t, &rowSums[(size_t)i * SH_FLOAT_COUNT]);
+            }
+        };
+        if (parallel)
+            ThreadPool::getShared().ParallelFor(rows, projectRows);
+        else
+            projectRows(0, rows);
+
+        double sums[SH_FLOAT_COUNT] = { 0.0 };
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < SH_FLOAT_COUNT; j++)
+                sums[j] += rowSums[(size_t)i * SH_FLOAT_COUNT + j];
+        }
+
+        //the projection carries one basis constant, the evaluation the other
+        for (int i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+            for (int c = 0; c < 3; c++)
+                coefficients[i * 3 + c] = (float)(sums[i * 3 + c] * BASIS[i] * BASIS[i] * LOBE[i]);
+        }
+    }
+
+    void evaluateAmbient(const float coefficients[SH_FLOAT_COUNT], float x, float y, float z, float rgb[3]) {
+
+        float basis[SH_COEFFICIENT_COUNT] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+        for (int c = 0; c < 3; c++) {
+            rgb[c] = 0.0f;
+            for (int i = 0; i < SH_COEFFICIENT_COUNT; i++)
+                rgb[c] += coefficients[i * 3 + c] * basis[i];
+        }
+    }
+
+    bool writeAmbientSH(const std::string& path, const SourceStamp& source, const float coefficients[SH_FLOAT_COUNT]) {
+
+        //written next to the target and renamed so a reader never sees half a file
+        std::string temporaryPath = path + ".tmp";
+        FILE* file = fopen(temporaryPath.c_str(), "w");
+        if (!file) {
+            return false;
+        }
+        fprintf(file, "%s %u\n%llu %llu %016llx\n", AMBIENT_HEADER, AMBIENT_VERSION, (unsigned long long)source.size,
+            (unsigned long long)source.modified, (unsigned long long)source.contentHash);
+        for (int i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+            fprintf(file, "%.9g %.9g %.9g\n", coefficients[i * 3], coefficients[i * 3 + 1], coefficients[i * 3 + 2]);
+        }
+        bool written = fclose(file) == 0;
+        if (!written) {
+            return false;
+        }
+        std::remove(path.c_str());
+        return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+    }
+
+    bool readAmbientSH(const std::string& path, const SourceStamp& source, float coefficients[SH_FLOAT_COUNT]) {
+
+        FILE* file = fopen(path.c_str(), "r");
+        if (!file) {
+            return false;
+        }
+
+        char header[32];
+        unsigned int version;
+        unsigned long long size, modified, contentHash;
+        bool valid = fscanf(file, "%31s %u %llu %llu %llx", header, &version, &size, &modified, &contentHash) == 5
+            && std::string(header) == AMBIENT_HEADER && version == AMBIENT_VERSION
+            && size == source.size && modified == source.modified && contentHash == source.contentHash;
+        for (int i = 0; i < SH_FLOAT_COUNT && valid; i++) {
+            valid = fscanf(file, "%f", &coefficients[i]) == 1 && std::isfinite(coefficients[i]);
+        }
+        fclose(file);
+        return valid;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SphericalHarmonics_hpp
+#define SphericalHarmonics_hpp
+
+#include "TextureCodec.hpp"
+
+#include <string>
+
+namespace gps {
+
+    // Order 2 spherical harmonics of the light arriving from a cube map, 9 RGB coefficients.
+    // They are already convolved with the cosine lobe, divided by pi and multiplied by the
+    // basis constants, so the diffuse ambient of a unit normal n is
+    //   c0 + c1 n.y + c2 n.z + c3 n.x + c4 n.x n.y + c5 n.y n.z + c6 (3 n.z^2 - 1) + c7 n.x n.z + c8 (n.x^2 - n.y^2)
+    // in linear light, which is what basic.frag evaluates.
+    const int SH_COEFFICIENT_COUNT = 9;
+    // floats of the coefficients, RGB after RGB like a vec3 uniform array
+    const int SH_FLOAT_COUNT = SH_COEFFICIENT_COUNT * 3;
+
+    // faces are size x size RGBA8 sRGB images in GL face order, rows as uploaded
+    // the rows are split over the shared thread pool and walked 4 texels at a time with SSE2,
+    // without parallel they all run on the calling thread, as a task on that pool must
+    void projectCubeMap(const unsigned char* const faces[6], int size, float coefficients[SH_FLOAT_COUNT], bool parallel = true);
+
+    // the sum above, for a normal in the cube map space
+    void evaluateAmbient(const float coefficients[SH_FLOAT_COUNT], float x, float y, float z, float rgb[3]);
+
+    // small text file holding the coefficients and the stamp of the faces they came from
+    bool writeAmbientSH(const std::string& path, const SourceStamp& source, const float coefficients[SH_FLOAT_COUNT]);
+    // fails on a missing or damaged file, or one written for another stamp
+    bool readAmbientSH(const std::string& path, const SourceStamp& source, float coefficients[SH_FLOAT_COUNT]);
+}
+
+#endif /* SphericalHarmonics_hpp */
@@ -0,0 +1,236 @@
+#include "TextureAtlas.hpp"
+#include "RenderBackend.hpp"
+#include "TextureCodec.hpp"
+#include "TextureManager.hpp"
+#include "ThreadPool.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+
+namespace gps {
+
+    namespace {
+
+        struct PackedImage {
+            std::vector<unsigned char> rgba;
+            int width;
+            int height;
+            // image, gutters and alignment
+            int tileWidth;
+            int tileHeight;
+            int x;
+            int y;
+            bool decoded;
+            bool placed;
+        };
+
+        // atlas sizes tried in order, the first one holding every image wins
+        const int ATLAS_SIZES[][2] = {
+            { 256, 256 }, { 512, 256 }, { 512, 512 }, { 1024, 512 },
+            { 1024, 1024 }, { 2048, 1024 }, { 2048, 2048 }
+        };
+
+        int alignTile(int size) {
+
+            return (size + TextureAtlas::ALIGNMENT - 1) / TextureAtlas::ALIGNMENT * TextureAtlas::ALIGNMENT;
+        }
+
+        // shelves filled left to right, order is by decreasing height, returns the images placed
+        size_t shelfPack(std::vector<PackedImage>& images, const std::vector<size_t>& order, int atlasWidth, int atlasHeight) {
+
+            int x = 0;
+            int y = 0;
+            int shelfHeight = 0;
+            size_t placed = 0;
+            for (size_t i = 0; i < order.size(); i++) {
+
+                PackedImage& image = images[order[i]];
+                image.placed = false;
+                if (image.tileWidth > atlasWidth) {
+                    continue;
+                }
+                if (x + image.tileWidth > atlasWidth) {
+                    y += shelfHeight;
+                    x = 0;
+                    shelfHeight = 0;
+                }
+                if (y + image.tileHeight > atlasHeight) {
+                    continue;
+                }
+
+                image.x = x;
+                image.y = y;
+                image.placed = true;
+                x += image.tileWidth;
+                shelfHeight = std::max(shelfHeight, image.tileHeight);
+                placed++;
+            }
+            return placed;
+        }
+    }
+
+    bool TextureAtlas::isSmallImage(const std::string& path) {
+
+        int x, y, n;
+        if (!stbi_info(path.c_str(), &x, &y, &n)) {
+            return false;
+        }
+        return alignTile(x + 2 * GUTTER) <= MAX_SIZE / 2 && alignTile(y + 2 * GUTTER) <= MAX_SIZE / 2;
+    }
+
+    std::vector<std::string> TextureAtlas::Build(const std::vector<std::string>& paths, bool compress) {
+
+        Delete();
+
+        std::vector<PackedImage> images(paths.size());
+        ThreadPool::getShared().ParallelFor((int)paths.size(), [&paths, &images](int begin, int end) {
+            for (int i = begin; i < end; i++)
+                images[i].decoded = TextureManager::DecodePixels(paths[i], images[i].rgba, images[i].width, images[i].height);
+        });
+
+        std::vector<size_t> order;
+        for (size_t i = 0; i < images.size(); i++) {
+            images[i].placed = false;
+            if (!images[i].decoded) {
+                continue;
+            }
+            images[i].tileWidth = alignTile(images[i].width + 2 * GUTTER);
+            images[i].tileHeight = alignTile(images[i].height + 2 * GUTTER);
+            order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&images](size_t a, size_t b) { return images[a].tileHeight > images[b].tileHeight; });
+
+        //the largest size keeps whatever it could place
+        size_t placed = 0;
+        for (size_t i = 0; i < sizeof(ATLAS_SIZES) / sizeof(ATLAS_SIZES[0]); i++) {
+            width = ATLAS_SIZES[i][0];
+            height = ATLAS_SIZES[i][1];
+            placed = shelfPack(images, order, width, height);
+            if (placed == order.size()) {
+                break;
+            }
+        }
+
+        std::vector<std::string> left;
+        if (placed == 0) {
+            width = 0;
+            height = 0;
+            return paths;
+        }
+
+        //the gutter and the alignment padding repeat the closest edge texel
+        std::vector<unsigned char> rgba((size_t)width * height * 4, 0);
+        for (size_t i = 0; i < images.size(); i++) {
+
+            const PackedImage& image = images[i];
+            if (!image.placed) {
+                left.push_back(paths[i]);
+                continue;
+            }
+
+            for (int ty = 0; ty < image.tileHeight; ty++) {
+                int sy = std::min(std::max(ty - GUTTER, 0), image.height - 1);
+                for (int tx = 0; tx < image.tileWidth; tx++) {
+                    int sx = std::min(std::max(tx - GUTTER, 0), image.width - 1);
+                    const unsigned char* source = &image.rgba[((size_t)sy * image.width + sx) * 4];
+                    std::copy(source, source + 4, &rgba[((size_t)(image.y + ty) * width + image.x + tx) * 4]);
+                }
+            }
+
+            Placement placement;
+            placement.offset = glm::vec2((float)(image.x + GUTTER) / width, (float)(image.y + GUTTER) / height);
+            placement.scale = glm::vec2((float)image.width / width, (float)image.height / height);
+            placements[TextureManager::canonicalPath(paths[i])] = placement;
+        }
+
+        Upload(rgba, compress);
+
+        return left;
+    }
+
+    void TextureAtlas::Upload(const std::vector<unsigned char>& rgba, bool compress) {
+
+        std::vector<std::vector<unsigned char> > levels;
+        buildMipLevels(rgba.data(), width, height, 4, true, levels);
+        levels.resize(std::min(levels.size(), (size_t)LEVEL_COUNT));
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.GenTextures(1, &texture);
+        backend.BindTexture(GL_TEXTURE_2D, texture);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+
+        uint32_t format = compress ? chooseBlockFormat(rgba.data(), width, height, true) : 0;
+        bytes = 0;
+        for (size_t level = 0; level < levels.size(); level++) {
+
+            GLsizei levelWidth = std::max(1, width >> level);
+            GLsizei levelHeight = std::max(1, height >> level);
+            if (compress) {
+                std::vector<unsigned char> blocks = compressLevel(levels[level].data(), levelWidth, levelHeight, format);
+                backend.CompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, getBlockInternalFormat(format), levelWidth, levelHeight, 0, (GLsizei)blocks.size(), blocks.data());
+                bytes += blocks.size();
+            }
+            else {
+                backend.TexImage2D(GL_TEXTURE_2D, (GLint)level, GL_SRGB8_ALPHA8, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].data());
+                bytes += levels[level].size();
+            }
+        }
+        backend.BindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void TextureAtlas::Delete() {
+
+        if (texture != 0) {
+            RenderBackend::getCurrent().DeleteTextures(1, &texture);
+        }
+        texture = 0;
+        width = 0;
+        height = 0;
+        bytes = 0;
+        placements.clear();
+    }
+
+    bool TextureAtlas::contains(const std::string& path) {
+
+        return placements.count(TextureManager::canonicalPath(path)) > 0;
+    }
+
+    glm::vec2 TextureAtlas::remap(const std::string& path, const glm::vec2& texCoords) {
+
+        std::unordered_map<std::string, Placement>::iterator found = placements.find(TextureManager::canonicalPath(path));
+        if (found == placements.end()) {
+            return texCoords;
+        }
+        return found->second.offset + texCoords * found->second.scale;
+    }
+
+    GLuint TextureAtlas::getTexture() {
+
+        return texture;
+    }
+
+    int TextureAtlas::getWidth() {
+
+        return width;
+    }
+
+    int TextureAtlas::getHeight() {
+
+        return height;
+    }
+
+    int TextureAtlas::getImageCount() {
+
+        return (int)placements.size();
+    }
+
+    size_t TextureAtlas::getBytes() {
+
+        return bytes;
+    }
+}
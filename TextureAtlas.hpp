@@ -0,0 +1,69 @@
+#ifndef TextureAtlas_hpp
+#define TextureAtlas_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gps {
+
+    // Packs small images into one texture so they stop costing a texture object and a bind each.
+    // Every image is surrounded by a gutter of repeated edge texels and starts on a multiple of
+    // ALIGNMENT, so none of the atlas levels blends neighbours, compressed blocks included.
+    // Only meshes whose texture coordinates stay within [0, 1] can use it, nothing repeats in an atlas.
+    class TextureAtlas {
+
+    public:
+        static const int MAX_SIZE = 2048;
+        static const int GUTTER = 16;
+        // one texel of gutter is left at the last level
+        static const int LEVEL_COUNT = 5;
+        // a 4x4 block at the last level
+        static const int ALIGNMENT = 4 << (LEVEL_COUNT - 1);
+
+        // images with their gutters up to half the largest atlas, reads the file header only
+        static bool isSmallImage(const std::string& path);
+
+        // packs as many of the images as fit into the smallest atlas holding them and uploads it
+        // returns the images left out, to go in another atlas or load on their own
+        std::vector<std::string> Build(const std::vector<std::string>& paths, bool compress);
+        void Delete();
+
+        bool contains(const std::string& path);
+        // texture coordinate of the image moved into its rectangle of the atlas
+        glm::vec2 remap(const std::string& path, const glm::vec2& texCoords);
+
+        GLuint getTexture();
+        int getWidth();
+        int getHeight();
+        int getImageCount();
+        // video memory of the atlas, every level included
+        size_t getBytes();
+
+    private:
+        struct Placement {
+            glm::vec2 offset;
+            glm::vec2 scale;
+        };
+
+        std::unordered_map<std::string, Placement> placements;
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        size_t bytes = 0;
+
+        void Upload(const std::vector<unsigned char>& rgba, bool compress);
+    };
+}
+
+#endif /* TextureAtlas_hpp */
@@ -0,0 +1,607 @@
+#include "TextureCodec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TEXTURE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+        // identifier, header and the fixed part of the index
+        const size_t KTX2_LEVEL_INDEX_OFFSET = 80;
+        const size_t KTX2_LEVEL_ENTRY_SIZE = 24;
+        const char* SOURCE_KEY = "gpsSource";
+        // stored with the source stamp, bumped when the encoder or the mip filter changes so older caches are rebuilt
+        const unsigned int CACHE_VERSION = 2;
+
+        // KHR_DF_MODEL_BC1A and KHR_DF_MODEL_BC3
+        const unsigned char DF_MODEL_BC1A = 128;
+        const unsigned char DF_MODEL_BC3 = 130;
+
+        void putU16(std::vector<unsigned char>& out, uint32_t value) {
+
+            out.push_back((unsigned char)(value & 0xFF));
+            out.push_back((unsigned char)((value >> 8) & 0xFF));
+        }
+
+        void putU32(std::vector<unsigned char>& out, uint32_t value) {
+
+            putU16(out, value & 0xFFFF);
+            putU16(out, value >> 16);
+        }
+
+        void putU64(std::vector<unsigned char>& out, uint64_t value) {
+
+            putU32(out, (uint32_t)(value & 0xFFFFFFFFu));
+            putU32(out, (uint32_t)(value >> 32));
+        }
+
+        void setU32(std::vector<unsigned char>& out, size_t offset, uint32_t value) {
+
+            for (int i = 0; i < 4; i++)
+                out[offset + i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+        }
+
+        void setU64(std::vector<unsigned char>& out, size_t offset, uint64_t value) {
+
+            setU32(out, offset, (uint32_t)(value & 0xFFFFFFFFu));
+            setU32(out, offset + 4, (uint32_t)(value >> 32));
+        }
+
+        // 8 bit sRGB to 16 bit linear and back, the round trip of every 8 bit value is exact
+        struct SrgbTables {
+            uint16_t toLinear[256];
+            unsigned char toSrgb[65536];
+        };
+
+        SrgbTables buildSrgbTables() {
+
+            SrgbTables tables;
+            for (int i = 0; i < 256; i++) {
+                double c = i / 255.0;
+                double linear = c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+                tables.toLinear[i] = (uint16_t)(linear * 65535.0 + 0.5);
+            }
+            for (int i = 0; i < 65536; i++) {
+                double linear = i / 65535.0;
+                double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * pow(linear, 1.0 / 2.4) - 0.055;
+                tables.toSrgb[i] = (unsigned char)std::min(255.0, c * 255.0 + 0.5);
+            }
+            return tables;
+        }
+
+        const SrgbTables& getSrgbTables() {
+
+            static const SrgbTables tables = buildSrgbTables();
+            return tables;
+        }
+
+        // 2x2 box over 16 bit texels, the odd last row and column are repeated
+        // rows are averaged first, 8 values at a time with SSE2, then the pairs of texels
+        template <int C>
+        void halveLevel(const uint16_t* source, int width, int height, uint16_t* target, std::vector<uint16_t>& rowSum) {
+
+            int nextWidth = std::max(1, width / 2);
+            int nextHeight = std::max(1, height / 2);
+            size_t rowValues = (size_t)width * C;
+            rowSum.resize(rowValues);
+
+            for (int y = 0; y < nextHeight; y++) {
+
+                const uint16_t* row0 = source + (size_t)std::min(2 * y, height - 1) * rowValues;
+                const uint16_t* row1 = source + (size_t)std::min(2 * y + 1, height - 1) * rowValues;
+                size_t i = 0;
+#ifdef TEXTURE_SSE2
+                for (; i + 8 <= rowValues; i += 8) {
+                    __m128i a = _mm_loadu_si128((const __m128i*)(row0 + i));
+                    __m128i b = _mm_loadu_si128((const __m128i*)(row1 + i));
+                    _mm_storeu_si128((__m128i*)(rowSum.data() + i), _mm_avg_epu16(a, b));
+                }
+#endif
+                for (; i < rowValues; i++) {
+                    rowSum[i] = (uint16_t)((row0[i] + row1[i] + 1) >> 1);
+                }
+
+                uint16_t* out = target + (size_t)y * nextWidth * C;
+                for (int x = 0; x < nextWidth; x++) {
+                    const uint16_t* texel0 = rowSum.data() + (size_t)std::min(2 * x, width - 1) * C;
+                    const uint16_t* texel1 = rowSum.data() + (size_t)std::min(2 * x + 1, width - 1) * C;
+                    for (int c = 0; c < C; c++)
+                        out[x * C + c] = (uint16_t)((texel0[c] + texel1[c] + 1) >> 1);
+                }
+            }
+        }
+
+        uint32_t getU32(const std::vector<unsigned char>& in, size_t offset) {
+
+            return (uint32_t)in[offset] | ((uint32_t)in[offset + 1] << 8) | ((uint32_t)in[offset + 2] << 16) | ((uint32_t)in[offset + 3] << 24);
+        }
+
+        uint64_t getU64(const std::vector<unsigned char>& in, size_t offset) {
+
+            return (uint64_t)getU32(in, offset) | ((uint64_t)getU32(in, offset + 4) << 32);
+        }
+
+        void padTo(std::vector<unsigned char>& out, size_t alignment) {
+
+            while (out.size() % alignment != 0)
+                out.push_back(0);
+        }
+
+        bool isBC3(uint32_t format) {
+
+            return format == BLOCK_BC3_UNORM || format == BLOCK_BC3_SRGB;
+        }
+
+        bool isSRGB(uint32_t format) {
+
+            return format == BLOCK_BC1_SRGB || format == BLOCK_BC3_SRGB;
+        }
+
+        size_t levelSize(int width, int height, uint32_t format) {
+
+            return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockBytes(format);
+        }
+
+        uint32_t pack565(const float color[3]) {
+
+            uint32_t r = (uint32_t)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+            uint32_t g = (uint32_t)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+            uint32_t b = (uint32_t)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+            return (r << 11) | (g << 5) | b;
+        }
+
+        void unpack565(uint32_t packed, int color[3]) {
+
+            int r = (packed >> 11) & 31;
+            int g = (packed >> 5) & 63;
+            int b = packed & 31;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        // 4 colour BC1 block, endpoints on the principal axis of the texel colours
+        void encodeColorBlock(const unsigned char block[16][4], unsigned char* out) {
+
+            float mean[3] = { 0.0f, 0.0f, 0.0f };
+            for (int i = 0; i < 16; i++)
+                for (int c = 0; c < 3; c++)
+                    mean[c] += block[i][c] / 16.0f;
+
+            float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int i = 0; i < 16; i++) {
+                float r = block[i][0] - mean[0];
+                float g = block[i][1] - mean[1];
+                float b = block[i][2] - mean[2];
+                covariance[0] += r * r;
+                covariance[1] += r * g;
+                covariance[2] += r * b;
+                covariance[3] += g * g;
+                covariance[4] += g * b;
+                covariance[5] += b * b;
+            }
+
+            //a few power iterations are enough for 16 points
+            float axis[3] = { 1.0f, 1.0f, 1.0f };
+            for (int iteration = 0; iteration < 4; iteration++) {
+                float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+                float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+                float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+                float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+                if (length < 1e-6f)
+                    break;
+                axis[0] = x / length;
+                axis[1] = y / length;
+                axis[2] = z / length;
+            }
+            float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+            float minProjection = 0.0f;
+            float maxProjection = 0.0f;
+            for (int i = 0; i < 16; i++) {
+                float projection = ((block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2]) / axisLength;
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+
+            float high[3], low[3];
+            for (int c = 0; c < 3; c++) {
+                high[c] = mean[c] + axis[c] * maxProjection;
+                low[c] = mean[c] + axis[c] * minProjection;
+            }
+
+            uint32_t color0 = pack565(high);
+            uint32_t color1 = pack565(low);
+            //color0 > color1 selects the 4 colour mode
+            if (color0 < color1)
+                std::swap(color0, color1);
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+
+                int palette[4][3];
+                unpack565(color0, palette[0]);
+                unpack565(color1, palette[1]);
+                for (int c = 0; c < 3; c++) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestDistance = 1 << 30;
+                    for (int p = 0; p < 4; p++) {
+                        int dr = block[i][0] - palette[p][0];
+                        int dg = block[i][1] - palette[p][1];
+                        int db = block[i][2] - palette[p][2];
+                        int distance = dr * dr + dg * dg + db * db;
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = p;
+                        }
+                    }
+                    indices |= (uint32_t)best << (2 * i);
+                }
+            }
+
+            out[0] = (unsigned char)(color0 & 0xFF);
+            out[1] = (unsigned char)(color0 >> 8);
+            out[2] = (unsigned char)(color1 & 0xFF);
+            out[3] = (unsigned char)(color1 >> 8);
+            for (int i = 0; i < 4; i++)
+                out[4 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+        }
+
+        // 8 level BC3 alpha block between the block minimum and maximum
+        void encodeAlphaBlock(const unsigned char block[16][4], unsigned char* out) {
+
+            int alpha0 = 0;
+            int alpha1 = 255;
+            for (int i = 0; i < 16; i++) {
+                alpha0 = std::max(alpha0, (int)block[i][3]);
+                alpha1 = std::min(alpha1, (int)block[i][3]);
+            }
+
+            uint64_t indices = 0;
+            if (alpha0 != alpha1) {
+
+                int palette[8];
+                palette[0] = alpha0;
+                palette[1] = alpha1;
+                for (int p = 1; p < 7; p++)
+                    palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestDistance = 256;
+                    for (int p = 0; p < 8; p++) {
+                        int distance = std::abs(block[i][3] - palette[p]);
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = p;
+                        }
+                    }
+                    indices |= (uint64_t)best << (3 * i);
+                }
+            }
+
+            out[0] = (unsigned char)alpha0;
+            out[1] = (unsigned char)alpha1;
+            for (int i = 0; i < 6; i++)
+                out[2 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+        }
+    }
+
+    bool getSourceStamp(const std::string& path, SourceStamp& stamp) {
+
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+
+        stamp.size = (uint64_t)info.st_size;
+        stamp.modified = (uint64_t)info.st_mtime;
+        return true;
+    }
+
+    void buildMipLevels(const unsigned char* pixels, int width, int height, int channels, bool srgb, std::vector<std::vector<unsigned char> >& levels) {
+
+        size_t values = (size_t)width * height * channels;
+        levels.clear();
+        levels.push_back(std::vector<unsigned char>(pixels, pixels + values));
+        if (width == 1 && height == 1) {
+            return;
+        }
+
+        //alpha is coverage, never sRGB encoded
+        const SrgbTables& tables = getSrgbTables();
+        int alpha = channels == 4 ? 3 : (channels == 2 ? 1 : -1);
+        bool linearChannel[4];
+        for (int c = 0; c < 4; c++) {
+            linearChannel[c] = !srgb || c == alpha;
+        }
+
+        std::vector<uint16_t> current(values);
+        for (size_t i = 0; i < values; i += channels) {
+            for (int c = 0; c < channels; c++)
+                current[i + c] = linearChannel[c] ? (uint16_t)(pixels[i + c] * 257) : tables.toLinear[pixels[i + c]];
+        }
+
+        std::vector<uint16_t> next;
+        std::vector<uint16_t> rowSum;
+        while (width > 1 || height > 1) {
+
+            int nextWidth = std::max(1, width / 2);
+            int nextHeight = std::max(1, height / 2);
+            next.resize((size_t)nextWidth * nextHeight * channels);
+            switch (channels) {
+            case 1: halveLevel<1>(current.data(), width, height, next.data(), rowSum); break;
+            case 2: halveLevel<2>(current.data(), width, height, next.data(), rowSum); break;
+            case 3: halveLevel<3>(current.data(), width, height, next.data(), rowSum); break;
+            default: halveLevel<4>(current.data(), width, height, next.data(), rowSum); break;
+            }
+
+            //each level is encoded on its own, the next one is filtered from the 16 bit values
+            std::vector<unsigned char> encoded(next.size());
+            for (size_t i = 0; i < next.size(); i += channels) {
+                for (int c = 0; c < channels; c++)
+                    encoded[i + c] = linearChannel[c] ? (unsigned char)((next[i + c] + 128) / 257) : tables.toSrgb[next[i + c]];
+            }
+            levels.push_back(std::move(encoded));
+
+            current.swap(next);
+            width = nextWidth;
+            height = nextHeight;
+        }
+    }
+
+    uint32_t chooseBlockFormat(const unsigned char* rgba, int width, int height, bool srgb) {
+
+        size_t texels = (size_t)width * height;
+        for (size_t i = 0; i < texels; i++) {
+            if (rgba[i * 4 + 3] != 255)
+                return srgb ? BLOCK_BC3_SRGB : BLOCK_BC3_UNORM;
+        }
+        return srgb ? BLOCK_BC1_SRGB : BLOCK_BC1_UNORM;
+    }
+
+    std::vector<unsigned char> compressLevel(const unsigned char* rgba, int width, int height, uint32_t format) {
+
+        int blocksX = (width + 3) / 4;
+        int blocksY = (height + 3) / 4;
+        int blockBytes = getBlockBytes(format);
+        std::vector<unsigned char> compressed((size_t)blocksX * blocksY * blockBytes);
+
+        unsigned char block[16][4];
+        for (int by = 0; by < blocksY; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min(bx * 4 + i % 4, width - 1);
+                    int y = std::min(by * 4 + i / 4, height - 1);
+                    memcpy(block[i], rgba + ((size_t)y * width + x) * 4, 4);
+                }
+
+                unsigned char* out = &compressed[((size_t)by * blocksX + bx) * blockBytes];
+                if (isBC3(format)) {
+                    encodeAlphaBlock(block, out);
+                    out += 8;
+                }
+                encodeColorBlock(block, out);
+            }
+        }
+
+        return compressed;
+    }
+
+    uint32_t toColorSpace(uint32_t format, bool srgb) {
+
+        if (isBC3(format))
+            return srgb ? BLOCK_BC3_SRGB : BLOCK_BC3_UNORM;
+        return srgb ? BLOCK_BC1_SRGB : BLOCK_BC1_UNORM;
+    }
+
+    GLenum getBlockInternalFormat(uint32_t format) {
+
+        switch (format) {
+        case BLOCK_BC1_UNORM: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BLOCK_BC1_SRGB: return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+        case BLOCK_BC3_UNORM: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BLOCK_BC3_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        default: return 0;
+        }
+    }
+
+    int getBlockBytes(uint32_t format) {
+
+        return isBC3(format) ? 16 : 8;
+    }
+
+    bool writeKTX2(const std::string& path, const MipChain& chain, const SourceStamp& source) {
+
+        if (getBlockInternalFormat(chain.format) == 0 || chain.levels.empty()) {
+            return false;
+        }
+
+        uint32_t levelCount = (uint32_t)chain.levels.size();
+        std::vector<unsigned char> file(KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+
+        putU32(file, chain.format);
+        putU32(file, 1); //typeSize
+        putU32(file, chain.width);
+        putU32(file, chain.height);
+        putU32(file, 0); //pixelDepth
+        putU32(file, 0); //layerCount
+        putU32(file, (uint32_t)chain.faces); //faceCount
+        putU32(file, levelCount);
+        putU32(file, 0); //supercompressionScheme
+
+        //dfd, kvd and sgd offsets are patched once known
+        size_t indexOffset = file.size();
+        file.resize(KTX2_LEVEL_INDEX_OFFSET + KTX2_LEVEL_ENTRY_SIZE * levelCount, 0);
+
+        //basic data format descriptor, one sample per 64 bit half of the block
+        size_t dfdOffset = file.size();
+        bool bc3 = isBC3(chain.format);
+        uint32_t sampleCount = bc3 ? 2 : 1;
+        putU32(file, 4 + 24 + 16 * sampleCount);
+        putU32(file, 0); //vendorId, descriptorType
+        putU16(file, 2); //versionNumber
+        putU16(file, 24 + 16 * sampleCount);
+        file.push_back(bc3 ? DF_MODEL_BC3 : DF_MODEL_BC1A);
+        file.push_back(1); //BT.709 primaries
+        file.push_back(isSRGB(chain.format) ? 2 : 1); //sRGB or linear transfer
+        file.push_back(0); //flags
+        putU32(file, 0x00000303); //4x4x1x1 texel block
+        putU32(file, (uint32_t)getBlockBytes(chain.format));
+        putU32(file, 0);
+        for (uint32_t sample = 0; sample < sampleCount; sample++) {
+            bool alphaSample = bc3 && sample == 0;
+            putU16(file, alphaSample || !bc3 ? 0 : 64); //bitOffset
+            file.push_back(63); //bitLength - 1
+            file.push_back(alphaSample ? 15 : 0); //alpha or colour channel
+            putU32(file, 0); //sample position
+            putU32(file, 0); //lower
+            putU32(file, 0xFFFFFFFFu); //upper
+        }
+        size_t dfdLength = file.size() - dfdOffset;
+
+        //key/value data, sorted by key
+        size_t kvdOffset = file.size();
+        char sourceValue[64];
+        snprintf(sourceValue, sizeof(sourceValue), "%llu %llu %016llx %u", (unsigned long long)source.size,
+            (unsigned long long)source.modified, (unsigned long long)source.contentHash, CACHE_VERSION);
+        const char* entries[3][2] = { { "KTXorientation", "ru" }, { "KTXwriter", "Graphic-Engine" }, { SOURCE_KEY, sourceValue } };
+        for (int i = 0; i < 3; i++) {
+            size_t keyLength = strlen(entries[i][0]) + 1;
+            size_t valueLength = strlen(entries[i][1]) + 1;
+            putU32(file, (uint32_t)(keyLength + valueLength));
+            file.insert(file.end(), entries[i][0], entries[i][0] + keyLength);
+            file.insert(file.end(), entries[i][1], entries[i][1] + valueLength);
+            padTo(file, 4);
+        }
+        size_t kvdLength = file.size() - kvdOffset;
+
+        setU32(file, indexOffset, (uint32_t)dfdOffset);
+        setU32(file, indexOffset + 4, (uint32_t)dfdLength);
+        setU32(file, indexOffset + 8, (uint32_t)kvdOffset);
+        setU32(file, indexOffset + 12, (uint32_t)kvdLength);
+        setU64(file, indexOffset + 16, 0);
+        setU64(file, indexOffset + 24, 0);
+
+        //the smallest level comes first in the file, the index lists level 0 first
+        size_t alignment = getBlockBytes(chain.format);
+        for (int level = (int)levelCount - 1; level >= 0; level--) {
+            padTo(file, alignment);
+            size_t entry = KTX2_LEVEL_INDEX_OFFSET + KTX2_LEVEL_ENTRY_SIZE * level;
+            setU64(file, entry, file.size());
+            setU64(file, entry + 8, chain.levels[level].size());
+            setU64(file, entry + 16, chain.levels[level].size());
+            file.insert(file.end(), chain.levels[level].begin(), chain.levels[level].end());
+        }
+
+        //written next to the target and renamed so a reader never sees half a file
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream out(temporaryPath, std::ios::binary);
+            if (!out.write((const char*)file.data(), file.size())) {
+                return false;
+            }
+        }
+        std::remove(path.c_str());
+        return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+    }
+
+    bool readKTX2(const std::string& path, MipChain& chain, SourceStamp& source) {
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        if (file.size() < KTX2_LEVEL_INDEX_OFFSET || memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+            return false;
+        }
+
+        chain.format = getU32(file, 12);
+        chain.width = (int)getU32(file, 20);
+        chain.height = (int)getU32(file, 24);
+        uint32_t depth = getU32(file, 28);
+        uint32_t layers = getU32(file, 32);
+        uint32_t faces = getU32(file, 36);
+        uint32_t levelCount = getU32(file, 40);
+        uint32_t supercompression = getU32(file, 44);
+
+        //only 2D and cube map block compressed files written by writeKTX2 are accepted
+        if (getBlockInternalFormat(chain.format) == 0 || depth != 0 || layers != 0 || supercompression != 0
+            || (faces != 1 && (faces != 6 || chain.width != chain.height))
+            || chain.width <= 0 || chain.height <= 0 || levelCount == 0 || levelCount > 32
+            || file.size() < KTX2_LEVEL_INDEX_OFFSET + KTX2_LEVEL_ENTRY_SIZE * levelCount) {
+            return false;
+        }
+
+        //source stamp from the key/value data
+        size_t kvdOffset = getU32(file, 56);
+        size_t kvdEnd = kvdOffset + getU32(file, 60);
+        if (kvdEnd > file.size()) {
+            return false;
+        }
+        bool stampFound = false;
+        size_t offset = kvdOffset;
+        while (offset + 4 <= kvdEnd) {
+            size_t length = getU32(file, offset);
+            if (offset + 4 + length > kvdEnd) {
+                return false;
+            }
+            std::string entry((const char*)&file[offset + 4], length);
+            size_t separator = entry.find('\0');
+            if (separator != std::string::npos && entry.compare(0, separator, SOURCE_KEY) == 0) {
+                unsigned long long size, modified, contentHash;
+                unsigned int version;
+                if (sscanf(entry.c_str() + separator + 1, "%llu %llu %llx %u", &size, &modified, &contentHash, &version) == 4
+                    && version == CACHE_VERSION) {
+                    source.size = size;
+                    source.modified = modified;
+                    source.contentHash = contentHash;
+                    stampFound = true;
+                }
+            }
+            offset += 4 + ((length + 3) & ~(size_t)3);
+        }
+        if (!stampFound) {
+            return false;
+        }
+
+        chain.faces = (int)faces;
+        chain.levels.resize(levelCount);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            size_t entry = KTX2_LEVEL_INDEX_OFFSET + KTX2_LEVEL_ENTRY_SIZE * level;
+            uint64_t levelOffset = getU64(file, entry);
+            uint64_t levelLength = getU64(file, entry + 8);
+            int width = std::max(1, chain.width >> level);
+            int height = std::max(1, chain.height >> level);
+            if (levelLength != levelSize(width, height, chain.format) * faces || levelOffset + levelLength > file.size()) {
+                return false;
+            }
+            chain.levels[level].assign(file.begin() + (size_t)levelOffset, file.begin() + (size_t)(levelOffset + levelLength));
+        }
+
+        return true;
+    }
+}
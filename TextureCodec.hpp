@@ -0,0 +1,79 @@
+#ifndef TextureCodec_hpp
+#define TextureCodec_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// S3TC enums, missing from some core profile headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+    #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace gps {
+
+    // block formats the encoder produces, values are the Vulkan format codes stored in KTX2
+    enum BlockFormat {
+        BLOCK_BC1_UNORM = 131,
+        BLOCK_BC1_SRGB = 132,
+        BLOCK_BC3_UNORM = 137,
+        BLOCK_BC3_SRGB = 138
+    };
+
+    // every level of a block compressed texture, level 0 first
+    // a cube map holds 6 faces, each level has them one after the other in GL face order
+    struct MipChain {
+        uint32_t format;
+        int width;
+        int height;
+        int faces = 1;
+        std::vector<std::vector<unsigned char> > levels;
+    };
+
+    // identifies the file a cache entry was built from, a mismatch means the cache is stale
+    struct SourceStamp {
+        uint64_t size;
+        uint64_t modified;
+        uint64_t contentHash;
+    };
+
+    // size and modification time of a file, false when it does not exist
+    bool getSourceStamp(const std::string& path, SourceStamp& stamp);
+
+    // halves the 8 bit image with a 2x2 box filter down to 1x1, level 0 included
+    // the filter runs on 16 bit values, linear light for the colour channels of sRGB images, alpha is always linear
+    void buildMipLevels(const unsigned char* pixels, int width, int height, int channels, bool srgb, std::vector<std::vector<unsigned char> >& levels);
+
+    // BC3 when any texel is not opaque, BC1 otherwise
+    uint32_t chooseBlockFormat(const unsigned char* rgba, int width, int height, bool srgb);
+
+    // encodes one RGBA8 level, the edge blocks repeat the last row and column
+    std::vector<unsigned char> compressLevel(const unsigned char* rgba, int width, int height, uint32_t format);
+
+    // same blocks read as sRGB or linear, only the format code differs
+    uint32_t toColorSpace(uint32_t format, bool srgb);
+
+    // GL internal format of a block format, 0 when unknown
+    GLenum getBlockInternalFormat(uint32_t format);
+    int getBlockBytes(uint32_t format);
+
+    // KTX2 container holding the chain, the source stamp goes in the key/value data
+    bool writeKTX2(const std::string& path, const MipChain& chain, const SourceStamp& source);
+    // fails on a missing, damaged or foreign file, or one written with another CACHE_VERSION
+    bool readKTX2(const std::string& path, MipChain& chain, SourceStamp& source);
+}
+
+#endif /* TextureCodec_hpp */
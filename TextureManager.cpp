@@ -0,0 +1,582 @@
+#include "TextureManager.hpp"
+#include "Hash.hpp"
+#include "RenderBackend.hpp"
+#include "ThreadPool.hpp"
+#include "TexturePreprocess.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#ifndef GL_SR8_EXT
+    #define GL_SR8_EXT 0x8FBD
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const char* LINEAR_SUFFIX = "|linear";
+
+        bool readFile(const std::string& path, std::vector<unsigned char>& contents) {
+
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                return false;
+            }
+
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        double toMegabytes(size_t bytes) {
+
+            return bytes / (1024.0 * 1024.0);
+        }
+    }
+
+    TextureManager& TextureManager::getInstance() {
+
+        static TextureManager manager;
+        return manager;
+    }
+
+    TextureManager::TextureManager() {
+
+#if not defined (__APPLE__)
+        srgbR8 = GLEW_EXT_texture_sRGB_R8 ? true : false;
+#endif
+    }
+
+    std::string TextureManager::getEntryKey(const std::string& path, TextureRole role) {
+
+        return canonicalPath(path) + (role == TEXTURE_DATA ? LINEAR_SUFFIX : "");
+    }
+
+    std::string TextureManager::canonicalPath(const std::string& path) {
+
+        std::string normalized = path;
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+#if defined (_WIN32)
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+
+        //rebuild the path from its components, dropping "." and resolving ".."
+        std::vector<std::string> parts;
+        std::stringstream stream(normalized);
+        std::string part;
+        while (std::getline(stream, part, '/')) {
+
+            if (part.empty() || part == ".") {
+                continue;
+            }
+            if (part == ".." && !parts.empty() && parts.back() != "..") {
+                parts.pop_back();
+                continue;
+            }
+            parts.push_back(part);
+        }
+
+        std::string canonical = (!normalized.empty() && normalized[0] == '/') ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++) {
+            canonical += (i > 0 ? "/" : "") + parts[i];
+        }
+        return canonical;
+    }
+
+    std::string TextureManager::findEntry(const std::string& key) {
+
+        std::unordered_map<std::string, std::string>::iterator alias = aliases.find(key);
+        return alias != aliases.end() ? alias->second : key;
+    }
+
+    bool TextureManager::initCompression() {
+
+#if defined (__APPLE__)
+        compression = true;
+#else
+        compression = GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+#endif
+        return compression;
+    }
+
+    bool TextureManager::isCompressionEnabled() {
+
+        return compression;
+    }
+
+    std::string TextureManager::getCachePath(const std::string& path, bool srgb) {
+
+        //the mips of sRGB images are filtered in linear light, data images need their own chain
+        return srgb ? path + ".ktx2" : path + ".linear.ktx2";
+    }
+
+    int TextureManager::TranscodeFiles(const std::vector<std::string>& paths) {
+
+        //Decode rebuilds the caches that are missing or stale and reads the others
+        std::vector<int> cached(paths.size(), 0);
+        ThreadPool::getShared().ParallelFor((int)paths.size(), [&](int begin, int end) {
+            for (int i = begin; i < end; i++)
+                cached[i] = Decode(paths[i], true, false, true).chain ? 1 : 0;
+        });
+
+        int count = 0;
+        for (size_t i = 0; i < cached.size(); i++) {
+            count += cached[i];
+        }
+        return count;
+    }
+
+    void TextureManager::Prefetch(const std::vector<std::string>& paths, TextureRole role) {
+
+        for (size_t i = 0; i < paths.size(); i++) {
+
+            std::string key = getEntryKey(paths[i], role);
+            if (textures.count(findEntry(key)) > 0 || pending.count(key) > 0) {
+                continue;
+            }
+
+            //decoded the way Acquire will use it, sRGB for colour and linear for data
+            std::string path = paths[i];
+            bool compress = compression;
+            bool srgb = role == TEXTURE_COLOR;
+            pending[key] = ThreadPool::getShared().Submit([path, compress, srgb]() { return Decode(path, compress, true, srgb); }).share();
+        }
+    }
+
+    void TextureManager::CancelPrefetch(const std::string& path) {
+
+        pending.erase(getEntryKey(path, TEXTURE_COLOR));
+        pending.erase(getEntryKey(path, TEXTURE_DATA));
+    }
+
+    bool TextureManager::DecodePixels(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height) {
+
+        DecodedImage image = Decode(path, false, false, true);
+        if (!image.pixels) {
+            return false;
+        }
+
+        width = image.width;
+        height = image.height;
+        size_t texels = (size_t)width * height;
+        rgba.resize(texels * 4);
+
+        //the channels were packed to what the image uses, back to RGBA
+        expandChannels(image.pixels.get(), texels, image.channels, rgba.data());
+        return true;
+    }
+
+    GLuint TextureManager::Acquire(const std::string& path, TextureRole role) {
+
+        std::string key = getEntryKey(path, role);
+        requests++;
+
+        //same file requested before, by this model or another one
+        std::unordered_map<std::string, Entry>::iterator found = textures.find(findEntry(key));
+        if (found != textures.end()) {
+            found->second.refCount++;
+            pathHits++;
+            savedBytes += found->second.bytes;
+            return found->second.id;
+        }
+
+        //wait for the prefetched decode, or decode here when nobody asked for it earlier
+        DecodedImage image;
+        std::unordered_map<std::string, std::shared_future<DecodedImage> >::iterator decoding = pending.find(key);
+        if (decoding != pending.end()) {
+            image = decoding->second.get();
+            pending.erase(decoding);
+        }
+        else {
+            image = Decode(path, compression, true, role == TEXTURE_COLOR);
+        }
+        decodeMs += image.decodeMs;
+
+        if (!image.pixels && !image.chain && !image.mips) {
+            fprintf(stderr, "ERROR: could not load %s\n", path.c_str());
+            return 0;
+        }
+
+        //a different file with identical content, used the same way
+        uint64_t contentKey = role == TEXTURE_DATA ? hashString(LINEAR_SUFFIX, image.contentHash) : image.contentHash;
+        if (contentDedup) {
+            std::unordered_map<uint64_t, std::string>::iterator owner = contentOwners.find(contentKey);
+            if (owner != contentOwners.end()) {
+                Entry& entry = textures[owner->second];
+                aliases[key] = owner->second;
+                entry.refCount++;
+                contentHits++;
+                savedBytes += entry.bytes;
+                return entry.id;
+            }
+        }
+
+        Entry entry;
+        entry.bytes = 0;
+        entry.id = ReadTextureFromFile(path, image, role, entry.bytes);
+        entry.rgbaBytes = (size_t)image.sourceWidth * image.sourceHeight * 4 * 4 / 3;
+        entry.refCount = 1;
+        entry.contentHash = contentKey;
+
+        textures[key] = entry;
+        contentOwners[contentKey] = key;
+
+        return entry.id;
+    }
+
+    void TextureManager::Release(const std::string& path, TextureRole role) {
+
+        std::string key = findEntry(getEntryKey(path, role));
+
+        std::unordered_map<std::string, Entry>::iterator found = textures.find(key);
+        if (found == textures.end()) {
+            return;
+        }
+
+        if (--found->second.refCount > 0) {
+            return;
+        }
+
+        //last user gone, free the texture and every name pointing at it
+        if (streamer) {
+            streamer->Unregister(found->second.id);
+        }
+        if (uploader) {
+            uploader->Cancel(found->second.id);
+        }
+        RenderBackend::getCurrent().DeleteTextures(1, &found->second.id);
+        contentOwners.erase(found->second.contentHash);
+        for (std::unordered_map<std::string, std::string>::iterator it = aliases.begin(); it != aliases.end();) {
+            if (it->second == key)
+                it = aliases.erase(it);
+            else
+                ++it;
+        }
+        textures.erase(found);
+    }
+
+    void TextureManager::setUploader(TextureUploader* textureUploader) {
+
+        uploader = textureUploader;
+    }
+
+    void TextureManager::setStreamer(TextureStreamer* textureStreamer) {
+
+        streamer = textureStreamer;
+    }
+
+    void TextureManager::setContentDedup(bool enabled) {
+
+        contentDedup = enabled;
+    }
+
+    double TextureManager::getDecodeMs() {
+
+        return decodeMs;
+    }
+
+    int TextureManager::getUniqueCount() {
+
+        return (int)textures.size();
+    }
+
+    void TextureManager::printStats() {
+
+        size_t residentBytes = 0;
+        size_t rgbaBytes = 0;
+        for (std::unordered_map<std::string, Entry>::iterator it = textures.begin(); it != textures.end(); ++it) {
+            residentBytes += it->second.bytes;
+            rgbaBytes += it->second.rgbaBytes;
+        }
+
+        std::cout << "Textures: " << textures.size() << " unique of " << requests << " requests ("
+            << pathHits << " by path, " << contentHits << " by content), "
+            << toMegabytes(residentBytes) << " MB resident (" << toMegabytes(rgbaBytes) << " MB as RGBA8), " << toMegabytes(savedBytes) << " MB saved, "
+            << decodeMs << " ms decoding on " << ThreadPool::getShared().getThreadCount() << " threads" << std::endl;
+    }
+
+    TextureManager::DecodedImage TextureManager::Decode(const std::string& path, bool compress, bool buildMips, bool srgb) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        DecodedImage image;
+        image.width = 0;
+        image.height = 0;
+        image.channels = 4;
+        image.sourceWidth = 0;
+        image.sourceHeight = 0;
+        image.contentHash = 0;
+
+        //an up to date cache skips reading and inflating the image
+        SourceStamp source;
+        bool sourceFound = getSourceStamp(path, source);
+        if (compress && sourceFound) {
+            std::shared_ptr<MipChain> chain = std::make_shared<MipChain>();
+            SourceStamp cached;
+            if (readKTX2(getCachePath(path, srgb), *chain, cached) && cached.size == source.size && cached.modified == source.modified) {
+                image.chain = chain;
+                image.width = image.sourceWidth = chain->width;
+                image.height = image.sourceHeight = chain->height;
+                image.channels = getBlockBytes(chain->format) == 16 ? 4 : 3;
+                image.contentHash = cached.contentHash;
+                image.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                return image;
+            }
+        }
+
+        std::vector<unsigned char> file;
+        if (sourceFound && readFile(path, file)) {
+
+            image.contentHash = hashBytes(file.data(), file.size());
+
+            int x, y, n;
+            int force_channels = 4;
+            unsigned char* image_data = stbi_load_from_memory(file.data(), (int)file.size(), &x, &y, &n, force_channels);
+
+            if (image_data) {
+
+                flipRows(image_data, x, y, 4);
+
+                image.pixels = std::shared_ptr<unsigned char>(image_data, stbi_image_free);
+                image.width = image.sourceWidth = x;
+                image.height = image.sourceHeight = y;
+
+                //what the texels actually use, whatever the file stores
+                bool grey = true;
+                bool alpha = false;
+                bool constant = true;
+                size_t texels = (size_t)x * y;
+                for (size_t i = 0; i < texels; i++) {
+                    const unsigned char* texel = image_data + i * 4;
+                    grey = grey && texel[0] == texel[1] && texel[0] == texel[2];
+                    alpha = alpha || texel[3] != 255;
+                    constant = constant && memcmp(texel, image_data, 4) == 0;
+                }
+                image.channels = grey ? (alpha ? 2 : 1) : (alpha ? 4 : 3);
+
+                //a single colour needs a single texel
+                if (constant) {
+                    image.width = 1;
+                    image.height = 1;
+                    texels = 1;
+                }
+
+                if (compress && !constant) {
+                    //the role still picks the sRGB or linear format at upload
+                    std::shared_ptr<MipChain> chain = std::make_shared<MipChain>();
+                    chain->format = chooseBlockFormat(image_data, x, y, true);
+                    chain->width = x;
+                    chain->height = y;
+
+                    std::vector<std::vector<unsigned char> > levels;
+                    buildMipLevels(image_data, x, y, 4, srgb, levels);
+                    for (size_t level = 0; level < levels.size(); level++) {
+                        int levelWidth = std::max(1, x >> level);
+                        int levelHeight = std::max(1, y >> level);
+                        chain->levels.push_back(compressLevel(levels[level].data(), levelWidth, levelHeight, chain->format));
+                    }
+
+                    source.contentHash = image.contentHash;
+                    if (!writeKTX2(getCachePath(path, srgb), *chain, source)) {
+                        fprintf(stderr, "WARNING: could not write the texture cache of %s\n", path.c_str());
+                    }
+
+                    image.chain = chain;
+                    image.channels = getBlockBytes(chain->format) == 16 ? 4 : 3;
+                    image.pixels.reset();
+                }
+                else {
+                    //packed in place, every texel moves towards the start
+                    packChannels(image_data, texels, image.channels);
+
+                    if (buildMips && !constant) {
+                        image.mips = std::make_shared<std::vector<std::vector<unsigned char> > >();
+                        buildMipLevels(image_data, x, y, image.channels, srgb, *image.mips);
+                        image.pixels.reset();
+                    }
+                }
+            }
+        }
+
+        image.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return image;
+    }
+
+    void TextureManager::UploadLevel(const TextureLevels& levels, int level) {
+
+        if (uploader) {
+            uploader->EnqueueLevel(levels, level, false, std::function<void(bool)>());
+            return;
+        }
+
+        TextureUploader::SpecifyLevel(levels, level, true);
+    }
+
+    GLuint TextureManager::ReadTextureFromFile(const std::string& path, const DecodedImage& image, TextureRole role, size_t& bytes) {
+
+        const char* file_name = path.c_str();
+        int x = image.width;
+        int y = image.height;
+        bool srgb = role == TEXTURE_COLOR;
+
+        // NPOT check
+        if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
+            fprintf(
+                stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
+            );
+        }
+
+        TextureLevels levels;
+        levels.width = x;
+        levels.height = y;
+        GLint swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+        int texelBytes = 0;
+        const char* formatName;
+
+        if (image.chain) {
+
+            const MipChain& chain = *image.chain;
+            uint32_t format = toColorSpace(chain.format, srgb);
+            levels.internalFormat = getBlockInternalFormat(format);
+            levels.format = levels.internalFormat;
+            levels.compressed = true;
+            for (size_t level = 0; level < chain.levels.size(); level++) {
+                levels.data.push_back(chain.levels[level].data());
+                levels.sizes.push_back(chain.levels[level].size());
+            }
+            levels.owner = image.chain;
+            formatName = getBlockBytes(format) == 16 ? "BC3" : "BC1";
+        }
+        else {
+
+            //smallest format holding the channels in use, grey is replicated by the swizzle
+            bool expandGreyAlpha = false;
+            levels.compressed = false;
+
+            switch (image.channels) {
+            case 1:
+                //without sRGB R8 a grey colour texture is stored as RGB, the driver pads it to 4 bytes
+                levels.internalFormat = !srgb ? GL_R8 : (srgbR8 ? GL_SR8_EXT : GL_SRGB8);
+                levels.format = GL_RED;
+                texelBytes = !srgb || srgbR8 ? 1 : 4;
+                swizzle[1] = GL_RED;
+                swizzle[2] = GL_RED;
+                swizzle[3] = GL_ONE;
+                formatName = "R8";
+                break;
+            case 2:
+                if (!srgb) {
+                    levels.internalFormat = GL_RG8;
+                    levels.format = GL_RG;
+                    texelBytes = 2;
+                    swizzle[1] = GL_RED;
+                    swizzle[2] = GL_RED;
+                    swizzle[3] = GL_GREEN;
+                    formatName = "RG8";
+                }
+                else {
+                    //there is no sRGB grey and alpha format, alpha must not be decoded as sRGB
+                    expandGreyAlpha = true;
+                    levels.internalFormat = GL_SRGB8_ALPHA8;
+                    levels.format = GL_RGBA;
+                    texelBytes = 4;
+                    formatName = "RGBA8";
+                }
+                break;
+            case 3:
+                levels.internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
+                levels.format = GL_RGB;
+                //RGB8 is padded to 4 bytes by the drivers
+                texelBytes = 4;
+                formatName = "RGB8";
+                break;
+            default:
+                levels.internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+                levels.format = GL_RGBA;
+                texelBytes = 4;
+                formatName = "RGBA8";
+                break;
+            }
+
+            //the mips come from the decode, only a constant 1x1 image has a single level
+            std::vector<const unsigned char*> source;
+            if (image.mips) {
+                for (size_t level = 0; level < image.mips->size(); level++)
+                    source.push_back((*image.mips)[level].data());
+                levels.owner = image.mips;
+            }
+            else {
+                source.push_back(image.pixels.get());
+                levels.owner = image.pixels;
+            }
+
+            std::shared_ptr<std::vector<std::vector<unsigned char> > > expanded;
+            if (expandGreyAlpha) {
+                expanded = std::make_shared<std::vector<std::vector<unsigned char> > >(source.size());
+                levels.owner = expanded;
+            }
+
+            for (size_t level = 0; level < source.size(); level++) {
+                size_t texels = (size_t)std::max(1, x >> level) * std::max(1, y >> level);
+                if (expandGreyAlpha) {
+                    std::vector<unsigned char>& rgba = (*expanded)[level];
+                    rgba.resize(texels * 4);
+                    expandChannels(source[level], texels, 2, rgba.data());
+                    levels.data.push_back(rgba.data());
+                    levels.sizes.push_back(rgba.size());
+                }
+                else {
+                    levels.data.push_back(source[level]);
+                    levels.sizes.push_back(texels * image.channels);
+                }
+            }
+        }
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        GLuint textureID;
+        backend.GenTextures(1, &textureID);
+        levels.texture = textureID;
+
+        backend.BindTexture(GL_TEXTURE_2D, textureID);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        backend.TexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+
+        //with streaming only the small levels are loaded now, the streamer brings in the others
+        int levelCount = (int)levels.data.size();
+        bool streamed = streamer && uploader && levelCount > 1;
+        int firstLevel = streamed ? TextureStreamer::getInitialLevel(x, y, levelCount) : 0;
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, firstLevel);
+        backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        backend.BindTexture(GL_TEXTURE_2D, 0);
+
+        bytes = 0;
+        for (int level = levelCount - 1; level >= firstLevel; level--) {
+            UploadLevel(levels, level);
+            bytes += levels.compressed ? levels.sizes[level] : (size_t)std::max(1, x >> level) * std::max(1, y >> level) * texelBytes;
+        }
+        if (streamed) {
+            streamer->Register(levels, firstLevel);
+        }
+
+        size_t rgbaBytes = (size_t)image.sourceWidth * image.sourceHeight * 4 * 4 / 3;
+        std::cout << "Texture " << path << ": " << image.sourceWidth << "x" << image.sourceHeight
+            << (x != image.sourceWidth || y != image.sourceHeight ? " constant, stored 1x1" : "")
+            << ", " << formatName << (srgb ? " sRGB" : " linear") << ", "
+            << rgbaBytes / 1024 << " KB -> " << bytes / 1024.0 << " KB"
+            << (streamed ? " (streamed from level " + std::to_string(firstLevel) + ")" : "") << std::endl;
+
+        return textureID;
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef TextureManager_hpp
+#define TextureManager_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "TextureCodec.hpp"
+#include "TextureUploader.hpp"
+#include "TextureStreamer.hpp"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gps {
+
+    // how the texels are sampled, colour is stored sRGB and data (specular, masks, ...) linear
+    enum TextureRole {
+        TEXTURE_COLOR,
+        TEXTURE_DATA
+    };
+
+    // Process wide texture cache shared by every Model3D.
+    // Textures are found by canonical path and, optionally, by a hash of the file content so
+    // the same image stored twice is uploaded once. They are reference counted and deleted
+    // when the last model releases them.
+    class TextureManager {
+
+    public:
+        static TextureManager& getInstance();
+
+        // block compressed textures through a KTX2 cache next to each image, when the driver has S3TC
+        bool initCompression();
+        bool isCompressionEnabled();
+
+        // starts decoding the images on the shared thread pool, Acquire with the same role then only uploads them
+        void Prefetch(const std::vector<std::string>& paths, TextureRole role);
+        // for a file that will not be acquired after all, its decodes are dropped once done
+        void CancelPrefetch(const std::string& path);
+
+        // texture of the image file, loaded on the first request, 0 when it cannot be read
+        // every successful Acquire needs a matching Release with the same role
+        GLuint Acquire(const std::string& path, TextureRole role = TEXTURE_COLOR);
+        void Release(const std::string& path, TextureRole role = TEXTURE_COLOR);
+
+        // uploads go through the PBO ring when set, otherwise straight from client memory
+        void setUploader(TextureUploader* textureUploader);
+
+        // textures load their small levels only and the streamer manages the rest, needs the uploader
+        // mips are then built on the workers instead of by the GL
+        void setStreamer(TextureStreamer* textureStreamer);
+
+        // also share identical files stored under different names, on by default
+        void setContentDedup(bool enabled);
+
+        int getUniqueCount();
+        // decode time summed over every thread, compare with the wall time of the load
+        double getDecodeMs();
+        void printStats();
+
+        // builds the missing or stale KTX2 caches of the images, needs no GL context
+        // returns how many images have an up to date cache afterwards
+        static int TranscodeFiles(const std::vector<std::string>& paths);
+
+        // RGBA8 pixels of the image, flipped like the textures, without touching the caches
+        // a single colour image comes back as 1x1, safe to run on any thread
+        static bool DecodePixels(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height);
+
+        // KTX2 cache file of an image, sRGB and linear use have different mip chains
+        static std::string getCachePath(const std::string& path, bool srgb);
+
+        // forward slashes, no "." or "dir/.." components, lower case on Windows
+        static std::string canonicalPath(const std::string& path);
+
+    private:
+        // image decoded and flipped on a worker, 8 bit pixels or a compressed mip chain
+        struct DecodedImage {
+            std::shared_ptr<unsigned char> pixels;
+            std::shared_ptr<MipChain> chain;
+            // every level of an uncompressed image, level 0 included
+            std::shared_ptr<std::vector<std::vector<unsigned char> > > mips;
+            int width;
+            int height;
+            // 1 grey, 2 grey and alpha, 3 RGB, 4 RGBA
+            int channels;
+            // size of the file before constant images are collapsed to 1x1
+            int sourceWidth;
+            int sourceHeight;
+            uint64_t contentHash;
+            double decodeMs;
+        };
+
+        struct Entry {
+            GLuint id;
+            int refCount;
+            // video memory of the texture, mip chain included
+            size_t bytes;
+            // what it took as RGBA8 before the format was chosen per image
+            size_t rgbaBytes;
+            uint64_t contentHash;
+        };
+
+        // by canonical path of the file that was loaded
+        std::unordered_map<std::string, Entry> textures;
+        // content hash to the path holding that texture
+        std::unordered_map<uint64_t, std::string> contentOwners;
+        // paths whose file matched the content of an already loaded one
+        std::unordered_map<std::string, std::string> aliases;
+        // decodes started by Prefetch and not acquired yet, by entry key so each role has its own
+        std::unordered_map<std::string, std::shared_future<DecodedImage> > pending;
+
+        TextureUploader* uploader = NULL;
+        TextureStreamer* streamer = NULL;
+        bool contentDedup = true;
+        bool compression = false;
+        // single channel sRGB textures, otherwise they are stored as RGB
+        bool srgbR8 = false;
+        int requests = 0;
+        int pathHits = 0;
+        int contentHits = 0;
+        size_t savedBytes = 0;
+        double decodeMs = 0.0;
+
+        TextureManager();
+
+        // resolves aliases, returns the key of the entry holding the texture
+        std::string findEntry(const std::string& key);
+        // colour and data uses of one file are separate textures
+        static std::string getEntryKey(const std::string& path, TextureRole role);
+
+        // reads, hashes and decodes the file, safe to run on any thread
+        // with compress the KTX2 cache is used instead, and written first when missing or stale
+        // with buildMips uncompressed images come with their whole mip chain, filtered on this thread
+        // srgb filters the colour channels of the mips in linear light, as the sampler reads them
+        static DecodedImage Decode(const std::string& path, bool compress, bool buildMips, bool srgb);
+
+        // through the uploader when there is one, otherwise right away
+        void UploadLevel(const TextureLevels& levels, int level);
+
+        // loads the decoded image into video memory in the smallest format that holds it
+        GLuint ReadTextureFromFile(const std::string& path, const DecodedImage& image, TextureRole role, size_t& bytes);
+    };
+}
+
+#endif /* TextureManager_hpp */
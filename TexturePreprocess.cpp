@@ -0,0 +1,333 @@
+#include "TexturePreprocess.hpp"
+
+#include "stb_image.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TEXTURE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+namespace gps {
+
+    namespace {
+
+        double millisecondsSince(std::chrono::steady_clock::time_point start) {
+
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // x / 255 rounded, exact for x up to 255 * 255
+        inline unsigned int divide255(unsigned int x) {
+
+            x += 128;
+            return (x + (x >> 8)) >> 8;
+        }
+
+        //the loops the passes replaced, kept to compare against
+        void flipRowsReference(unsigned char* pixels, int width, int height, int bytesPerPixel) {
+
+            int widthInBytes = width * bytesPerPixel;
+            for (int row = 0; row < height / 2; row++) {
+                unsigned char* top = pixels + row * widthInBytes;
+                unsigned char* bottom = pixels + (height - row - 1) * widthInBytes;
+                for (int col = 0; col < widthInBytes; col++) {
+                    unsigned char temp = *top;
+                    *top++ = *bottom;
+                    *bottom++ = temp;
+                }
+            }
+        }
+
+        void packChannelsReference(unsigned char* rgba, size_t texels, int channels) {
+
+            for (size_t i = 0; i < texels; i++) {
+                for (int c = 0; c < channels; c++) {
+                    int sourceChannel = channels == 2 && c == 1 ? 3 : c;
+                    rgba[i * channels + c] = rgba[i * 4 + sourceChannel];
+                }
+            }
+        }
+
+        void expandChannelsReference(const unsigned char* source, size_t texels, int channels, unsigned char* rgba) {
+
+            for (size_t i = 0; i < texels; i++) {
+                const unsigned char* texel = source + i * channels;
+                bool grey = channels <= 2;
+                rgba[i * 4] = texel[0];
+                rgba[i * 4 + 1] = grey ? texel[0] : texel[1];
+                rgba[i * 4 + 2] = grey ? texel[0] : texel[2];
+                rgba[i * 4 + 3] = channels == 2 ? texel[1] : (channels == 4 ? texel[3] : 255);
+            }
+        }
+
+        void premultiplyAlphaReference(unsigned char* rgba, size_t texels) {
+
+            for (size_t i = 0; i < texels; i++) {
+                unsigned char* texel = rgba + i * 4;
+                for (int c = 0; c < 3; c++)
+                    texel[c] = (unsigned char)((texel[c] * texel[3] + 127) / 255);
+            }
+        }
+    }
+
+    void flipRows(unsigned char* pixels, int width, int height, int bytesPerPixel) {
+
+        size_t rowBytes = (size_t)width * bytesPerPixel;
+        for (int row = 0; row < height / 2; row++) {
+
+            unsigned char* top = pixels + row * rowBytes;
+            unsigned char* bottom = pixels + (height - row - 1) * rowBytes;
+            size_t i = 0;
+#ifdef TEXTURE_SSE2
+            //both rows go through registers once, no temporary row
+            for (; i + 16 <= rowBytes; i += 16) {
+                __m128i a = _mm_loadu_si128((const __m128i*)(top + i));
+                __m128i b = _mm_loadu_si128((const __m128i*)(bottom + i));
+                _mm_storeu_si128((__m128i*)(top + i), b);
+                _mm_storeu_si128((__m128i*)(bottom + i), a);
+            }
+#endif
+            //whole words for the rest, then bytes
+            for (; i + 8 <= rowBytes; i += 8) {
+                uint64_t a, b;
+                memcpy(&a, top + i, 8);
+                memcpy(&b, bottom + i, 8);
+                memcpy(top + i, &b, 8);
+                memcpy(bottom + i, &a, 8);
+            }
+            for (; i < rowBytes; i++) {
+                unsigned char temp = top[i];
+                top[i] = bottom[i];
+                bottom[i] = temp;
+            }
+        }
+    }
+
+    void packChannels(unsigned char* rgba, size_t texels, int channels) {
+
+        //every write lands before the first texel not read yet, so in place is safe
+        size_t i = 0;
+        if (channels == 1) {
+#ifdef TEXTURE_SSE2
+            const __m128i low = _mm_set1_epi32(0xFF);
+            for (; i + 16 <= texels; i += 16) {
+                const __m128i* source = (const __m128i*)(rgba + i * 4);
+                __m128i r0 = _mm_and_si128(_mm_loadu_si128(source), low);
+                __m128i r1 = _mm_and_si128(_mm_loadu_si128(source + 1), low);
+                __m128i r2 = _mm_and_si128(_mm_loadu_si128(source + 2), low);
+                __m128i r3 = _mm_and_si128(_mm_loadu_si128(source + 3), low);
+                __m128i packed = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+                _mm_storeu_si128((__m128i*)(rgba + i), packed);
+            }
+#endif
+            for (; i < texels; i++)
+                rgba[i] = rgba[i * 4];
+        }
+        else if (channels == 2) {
+#ifdef TEXTURE_SSE2
+            //red and alpha into the low 16 bits of each lane, biased so the signed pack keeps them
+            const __m128i low = _mm_set1_epi32(0xFF);
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            const __m128i unbias = _mm_set1_epi16((short)0x8000);
+            for (; i + 8 <= texels; i += 8) {
+                const __m128i* source = (const __m128i*)(rgba + i * 4);
+                __m128i v0 = _mm_loadu_si128(source);
+                __m128i v1 = _mm_loadu_si128(source + 1);
+                __m128i p0 = _mm_or_si128(_mm_and_si128(v0, low), _mm_slli_epi32(_mm_srli_epi32(v0, 24), 8));
+                __m128i p1 = _mm_or_si128(_mm_and_si128(v1, low), _mm_slli_epi32(_mm_srli_epi32(v1, 24), 8));
+                __m128i packed = _mm_packs_epi32(_mm_sub_epi32(p0, bias), _mm_sub_epi32(p1, bias));
+                _mm_storeu_si128((__m128i*)(rgba + i * 2), _mm_xor_si128(packed, unbias));
+            }
+#endif
+            for (; i < texels; i++) {
+                rgba[i * 2] = rgba[i * 4];
+                rgba[i * 2 + 1] = rgba[i * 4 + 3];
+            }
+        }
+        else if (channels == 3) {
+            //four bytes at a time, the spare one is overwritten by the next texel
+            for (; i + 1 < texels; i++) {
+                uint32_t texel;
+                memcpy(&texel, rgba + i * 4, 4);
+                memcpy(rgba + i * 3, &texel, 4);
+            }
+            for (; i < texels; i++) {
+                rgba[i * 3] = rgba[i * 4];
+                rgba[i * 3 + 1] = rgba[i * 4 + 1];
+                rgba[i * 3 + 2] = rgba[i * 4 + 2];
+            }
+        }
+    }
+
+    void expandChannels(const unsigned char* source, size_t texels, int channels, unsigned char* rgba) {
+
+        size_t i = 0;
+        if (channels == 4) {
+            memcpy(rgba, source, texels * 4);
+        }
+        else if (channels == 1) {
+#ifdef TEXTURE_SSE2
+            const __m128i opaque = _mm_set1_epi8((char)0xFF);
+            for (; i + 16 <= texels; i += 16) {
+                __m128i grey = _mm_loadu_si128((const __m128i*)(source + i));
+                __m128i greyGreyLow = _mm_unpacklo_epi8(grey, grey);
+                __m128i greyGreyHigh = _mm_unpackhi_epi8(grey, grey);
+                __m128i greyAlphaLow = _mm_unpacklo_epi8(grey, opaque);
+                __m128i greyAlphaHigh = _mm_unpackhi_epi8(grey, opaque);
+                __m128i* target = (__m128i*)(rgba + i * 4);
+                _mm_storeu_si128(target, _mm_unpacklo_epi16(greyGreyLow, greyAlphaLow));
+                _mm_storeu_si128(target + 1, _mm_unpackhi_epi16(greyGreyLow, greyAlphaLow));
+                _mm_storeu_si128(target + 2, _mm_unpacklo_epi16(greyGreyHigh, greyAlphaHigh));
+                _mm_storeu_si128(target + 3, _mm_unpackhi_epi16(greyGreyHigh, greyAlphaHigh));
+            }
+#endif
+            for (; i < texels; i++) {
+                rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = source[i];
+                rgba[i * 4 + 3] = 255;
+            }
+        }
+        else if (channels == 2) {
+#ifdef TEXTURE_SSE2
+            const __m128i low = _mm_set1_epi16(0xFF);
+            for (; i + 8 <= texels; i += 8) {
+                __m128i greyAlpha = _mm_loadu_si128((const __m128i*)(source + i * 2));
+                __m128i grey = _mm_and_si128(greyAlpha, low);
+                __m128i greyGrey = _mm_or_si128(grey, _mm_slli_epi16(grey, 8));
+                __m128i* target = (__m128i*)(rgba + i * 4);
+                _mm_storeu_si128(target, _mm_unpacklo_epi16(greyGrey, greyAlpha));
+                _mm_storeu_si128(target + 1, _mm_unpackhi_epi16(greyGrey, greyAlpha));
+            }
+#endif
+            for (; i < texels; i++) {
+                rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = source[i * 2];
+                rgba[i * 4 + 3] = source[i * 2 + 1];
+            }
+        }
+        else {
+            //four bytes at a time with alpha forced, the last texel cannot read past the end
+            for (; i + 1 < texels; i++) {
+                uint32_t texel;
+                memcpy(&texel, source + i * 3, 4);
+                texel |= 0xFF000000u;
+                memcpy(rgba + i * 4, &texel, 4);
+            }
+            for (; i < texels; i++) {
+                rgba[i * 4] = source[i * 3];
+                rgba[i * 4 + 1] = source[i * 3 + 1];
+                rgba[i * 4 + 2] = source[i * 3 + 2];
+                rgba[i * 4 + 3] = 255;
+            }
+        }
+    }
+
+    void premultiplyAlpha(unsigned char* rgba, size_t texels) {
+
+        size_t i = 0;
+#ifdef TEXTURE_SSE2
+        //two texels per register as 16 bit lanes, alpha multiplies itself by 255
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i colourLanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+        const __m128i half = _mm_set1_epi16(128);
+        for (; i + 4 <= texels; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            __m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+            for (int h = 0; h < 2; h++) {
+                __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[h], 0xFF), 0xFF);
+                alpha = _mm_or_si128(_mm_and_si128(alpha, colourLanes), alphaOne);
+                __m128i x = _mm_add_epi16(_mm_mullo_epi16(halves[h], alpha), half);
+                halves[h] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+            }
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+        }
+#endif
+        for (; i < texels; i++) {
+            unsigned char* texel = rgba + i * 4;
+            for (int c = 0; c < 3; c++)
+                texel[c] = (unsigned char)divide255(texel[c] * texel[3]);
+        }
+    }
+
+    PreprocessTimings benchmarkPreprocessing(const std::vector<std::string>& paths, int repeats) {
+
+        PreprocessTimings timings;
+        memset(&timings, 0, sizeof(timings));
+
+        std::vector<unsigned char> work;
+        std::vector<unsigned char> expanded;
+        for (size_t p = 0; p < paths.size(); p++) {
+
+            int x, y, n;
+            unsigned char* data = stbi_load(paths[p].c_str(), &x, &y, &n, 4);
+            if (!data) {
+                continue;
+            }
+            size_t texels = (size_t)x * y;
+            std::vector<unsigned char> image(data, data + texels * 4);
+            stbi_image_free(data);
+
+            timings.images++;
+            timings.bytes += image.size();
+            expanded.resize(image.size());
+
+            for (int r = 0; r < repeats; r++) {
+
+                std::chrono::steady_clock::time_point start;
+
+                work = image;
+                start = std::chrono::steady_clock::now();
+                flipRows(work.data(), x, y, 4);
+                timings.flipMs += millisecondsSince(start);
+                start = std::chrono::steady_clock::now();
+                flipRowsReference(work.data(), x, y, 4);
+                timings.flipReferenceMs += millisecondsSince(start);
+
+                //every packed layout the manager uses, then back to RGBA from it
+                for (int channels = 1; channels <= 3; channels++) {
+                    work = image;
+                    start = std::chrono::steady_clock::now();
+                    packChannels(work.data(), texels, channels);
+                    timings.packMs += millisecondsSince(start);
+
+                    start = std::chrono::steady_clock::now();
+                    expandChannels(work.data(), texels, channels, expanded.data());
+                    timings.expandMs += millisecondsSince(start);
+                    start = std::chrono::steady_clock::now();
+                    expandChannelsReference(work.data(), texels, channels, expanded.data());
+                    timings.expandReferenceMs += millisecondsSince(start);
+
+                    work = image;
+                    start = std::chrono::steady_clock::now();
+                    packChannelsReference(work.data(), texels, channels);
+                    timings.packReferenceMs += millisecondsSince(start);
+                }
+
+                work = image;
+                start = std::chrono::steady_clock::now();
+                premultiplyAlpha(work.data(), texels);
+                timings.premultiplyMs += millisecondsSince(start);
+                work = image;
+                start = std::chrono::steady_clock::now();
+                premultiplyAlphaReference(work.data(), texels);
+                timings.premultiplyReferenceMs += millisecondsSince(start);
+            }
+        }
+
+        if (repeats > 0) {
+            double scale = 1.0 / repeats;
+            timings.flipMs *= scale;
+            timings.flipReferenceMs *= scale;
+            timings.packMs *= scale;
+            timings.packReferenceMs *= scale;
+            timings.expandMs *= scale;
+            timings.expandReferenceMs *= scale;
+            timings.premultiplyMs *= scale;
+            timings.premultiplyReferenceMs *= scale;
+        }
+        return timings;
+    }
+}
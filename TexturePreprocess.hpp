@@ -0,0 +1,44 @@
+#ifndef TexturePreprocess_hpp
+#define TexturePreprocess_hpp
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Pixel passes run on every decoded image before it becomes a texture.
+    // They use SSE2 where the compiler targets it and plain loops elsewhere, the results are the same.
+
+    // swaps the rows in place, images are stored top down and GL wants the first row at the bottom
+    void flipRows(unsigned char* pixels, int width, int height, int bytesPerPixel);
+
+    // RGBA8 texels packed in place into their first channels bytes
+    // 1 keeps red, 2 keeps red and alpha (grey and alpha images), 3 keeps RGB
+    void packChannels(unsigned char* rgba, size_t texels, int channels);
+
+    // the other way, grey is replicated to RGB and missing alpha is opaque, source and rgba must not overlap
+    void expandChannels(const unsigned char* source, size_t texels, int channels, unsigned char* rgba);
+
+    // rgb * alpha / 255, rounded
+    void premultiplyAlpha(unsigned char* rgba, size_t texels);
+
+    // milliseconds per pass over a set of images, the plain byte loops next to the ones above
+    struct PreprocessTimings {
+        int images;
+        size_t bytes;
+        double flipMs;
+        double flipReferenceMs;
+        double packMs;
+        double packReferenceMs;
+        double expandMs;
+        double expandReferenceMs;
+        double premultiplyMs;
+        double premultiplyReferenceMs;
+    };
+
+    // decodes the images once, then times every pass repeats times on fresh copies
+    PreprocessTimings benchmarkPreprocessing(const std::vector<std::string>& paths, int repeats);
+}
+
+#endif /* TexturePreprocess_hpp */
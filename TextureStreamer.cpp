@@ -0,0 +1,260 @@
+#include "TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    namespace {
+
+        // edge of the largest level uploaded before the first request
+        const int INITIAL_LEVEL_SIZE = 128;
+    }
+
+    void TextureStreamer::Create(TextureUploader* textureUploader, double budgetMB) {
+
+        uploader = textureUploader;
+        setBudget(budgetMB);
+    }
+
+    void TextureStreamer::Delete() {
+
+        textures.clear();
+        uploader = NULL;
+    }
+
+    int TextureStreamer::getInitialLevel(int width, int height, int levelCount) {
+
+        int level = 0;
+        while (level < levelCount - 1 && std::max(width >> level, height >> level) > INITIAL_LEVEL_SIZE) {
+            level++;
+        }
+        return level;
+    }
+
+    size_t TextureStreamer::getLevelBytes(const TextureLevels& levels, int level) {
+
+        if (levels.compressed) {
+            return levels.sizes[level];
+        }
+
+        //RGB8 is padded to 4 bytes by the drivers
+        size_t texels = (size_t)std::max(1, levels.width >> level) * std::max(1, levels.height >> level);
+        size_t texelBytes = levels.sizes[level] / texels;
+        return texels * (texelBytes == 3 ? 4 : texelBytes);
+    }
+
+    void TextureStreamer::Register(const TextureLevels& levels, int firstLevel) {
+
+        StreamedTexture texture;
+        texture.levels = levels;
+        texture.residentLevel = firstLevel;
+        texture.loadingLevel = firstLevel;
+        texture.arrived = 0;
+        texture.requestedLevel = firstLevel;
+        texture.lastUsed = 0;
+
+        for (int level = firstLevel; level < (int)levels.sizes.size(); level++) {
+            texture.arrived |= 1u << level;
+            residentBytes += getLevelBytes(levels, level);
+        }
+
+        textures[levels.texture] = texture;
+    }
+
+    void TextureStreamer::Unregister(GLuint texture) {
+
+        std::unordered_map<GLuint, StreamedTexture>::iterator found = textures.find(texture);
+        if (found == textures.end()) {
+            return;
+        }
+
+        for (int level = found->second.loadingLevel; level < (int)found->second.levels.sizes.size(); level++) {
+            residentBytes -= getLevelBytes(found->second.levels, level);
+        }
+        textures.erase(found);
+    }
+
+    void TextureStreamer::Request(GLuint texture, float uvPerPixel) {
+
+        std::unordered_map<GLuint, StreamedTexture>::iterator found = textures.find(texture);
+        if (found == textures.end()) {
+            return;
+        }
+
+        //one texel per pixel on the largest edge, finer levels would only alias
+        StreamedTexture& streamed = found->second;
+        int lastLevel = (int)streamed.levels.sizes.size() - 1;
+        float texelsPerPixel = uvPerPixel * std::max(streamed.levels.width, streamed.levels.height);
+        int level = texelsPerPixel > 1.0f ? (int)std::floor(std::log2(texelsPerPixel)) : 0;
+        level = std::min(std::max(level, 0), lastLevel);
+
+        if (streamed.lastUsed != frame) {
+            streamed.requestedLevel = level;
+            streamed.lastUsed = frame;
+        }
+        else {
+            streamed.requestedLevel = std::min(streamed.requestedLevel, level);
+        }
+    }
+
+    void TextureStreamer::Update() {
+
+        requestedBytes = 0;
+        for (std::unordered_map<GLuint, StreamedTexture>::iterator it = textures.begin(); it != textures.end(); ++it) {
+
+            StreamedTexture& streamed = it->second;
+            for (int level = streamed.requestedLevel; level < (int)streamed.levels.sizes.size(); level++) {
+                requestedBytes += getLevelBytes(streamed.levels, level);
+            }
+
+            //one level per texture and frame, coarse to fine
+            if (streamed.lastUsed != frame || streamed.requestedLevel >= streamed.loadingLevel || !uploader) {
+                continue;
+            }
+
+            int level = streamed.loadingLevel - 1;
+            size_t bytes = getLevelBytes(streamed.levels, level);
+            if (!MakeRoom(bytes, it->first)) {
+                continue;
+            }
+
+            GLuint texture = it->first;
+            uploader->EnqueueLevel(streamed.levels, level, false, [this, texture, level](bool uploaded) {
+                if (uploaded)
+                    LevelArrived(texture, level);
+                else
+                    LevelFailed(texture);
+            });
+            streamed.loadingLevel = level;
+            residentBytes += bytes;
+            streamedBytes += bytes;
+        }
+
+        frame++;
+    }
+
+    void TextureStreamer::LevelArrived(GLuint texture, int level) {
+
+        std::unordered_map<GLuint, StreamedTexture>::iterator found = textures.find(texture);
+        if (found == textures.end()) {
+            return;
+        }
+
+        //levels may land out of order, the base only moves over a contiguous chain
+        StreamedTexture& streamed = found->second;
+        streamed.arrived |= 1u << level;
+        int residentLevel = streamed.residentLevel;
+        while (residentLevel > streamed.loadingLevel && (streamed.arrived & (1u << (residentLevel - 1)))) {
+            residentLevel--;
+        }
+
+        if (residentLevel != streamed.residentLevel) {
+            streamed.residentLevel = residentLevel;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residentLevel);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+
+    void TextureStreamer::LevelFailed(GLuint texture) {
+
+        std::unordered_map<GLuint, StreamedTexture>::iterator found = textures.find(texture);
+        if (found == textures.end()) {
+            return;
+        }
+
+        //the finer levels may still be in flight, all of them are dropped and asked for again from the resident one
+        StreamedTexture& streamed = found->second;
+        uploader->Cancel(texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (int level = streamed.loadingLevel; level < streamed.residentLevel; level++) {
+            residentBytes -= getLevelBytes(streamed.levels, level);
+            streamed.arrived &= ~(1u << level);
+            FreeLevel(streamed.levels, level);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        streamed.loadingLevel = streamed.residentLevel;
+    }
+
+    bool TextureStreamer::MakeRoom(size_t bytes, GLuint keep) {
+
+        while (residentBytes + bytes > budget) {
+
+            //least recently used first, a texture drawn this frame only gives up levels finer than it asked for
+            StreamedTexture* victim = NULL;
+            for (std::unordered_map<GLuint, StreamedTexture>::iterator it = textures.begin(); it != textures.end(); ++it) {
+
+                StreamedTexture& candidate = it->second;
+                bool idle = candidate.loadingLevel == candidate.residentLevel;
+                bool hasLevels = candidate.residentLevel < (int)candidate.levels.sizes.size() - 1;
+                bool unneeded = candidate.lastUsed != frame || candidate.residentLevel < candidate.requestedLevel;
+                if (it->first == keep || !idle || !hasLevels || !unneeded) {
+                    continue;
+                }
+                if (!victim || candidate.lastUsed < victim->lastUsed) {
+                    victim = &candidate;
+                }
+            }
+
+            if (!victim) {
+                return false;
+            }
+            Evict(*victim);
+        }
+        return true;
+    }
+
+    void TextureStreamer::Evict(StreamedTexture& texture) {
+
+        int level = texture.residentLevel;
+        texture.residentLevel++;
+        texture.loadingLevel++;
+        texture.arrived &= ~(1u << level);
+
+        glBindTexture(GL_TEXTURE_2D, texture.levels.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentLevel);
+        FreeLevel(texture.levels, level);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        size_t bytes = getLevelBytes(texture.levels, level);
+        residentBytes -= bytes;
+        evictedBytes += bytes;
+    }
+
+    void TextureStreamer::FreeLevel(const TextureLevels& levels, int level) {
+
+        //a zero sized level below the base frees its memory and leaves the texture complete
+        if (levels.compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, levels.internalFormat, 0, 0, 0, 0, NULL);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, level, levels.internalFormat, 0, 0, 0, levels.format, GL_UNSIGNED_BYTE, NULL);
+        }
+    }
+
+    void TextureStreamer::setBudget(double budgetMB) {
+
+        budget = (size_t)(budgetMB * 1024.0 * 1024.0);
+    }
+
+    size_t TextureStreamer::getResidentBytes() {
+
+        return residentBytes;
+    }
+
+    size_t TextureStreamer::getRequestedBytes() {
+
+        return requestedBytes;
+    }
+
+    size_t TextureStreamer::getEvictedBytes() {
+
+        return evictedBytes;
+    }
+
+    size_t TextureStreamer::getStreamedBytes() {
+
+        return streamedBytes;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef TextureStreamer_hpp
+#define TextureStreamer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "TextureUploader.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace gps {
+
+    // Keeps only the mip levels the renderer needs in video memory.
+    // Textures start with their small levels, each frame the draws report how fine a level they
+    // sample and the missing levels are streamed in through the uploader. When the budget is
+    // reached the finest levels of the least recently used textures are dropped again.
+    // Levels above GL_TEXTURE_BASE_LEVEL are respecified with zero size so their memory is freed.
+    class TextureStreamer {
+
+    public:
+        void Create(TextureUploader* textureUploader, double budgetMB);
+        void Delete();
+
+        // the level data stays in memory to be streamed again after an eviction
+        // levels from firstLevel down have already been uploaded
+        void Register(const TextureLevels& levels, int firstLevel);
+        void Unregister(GLuint texture);
+
+        // uvPerPixel is the texture coordinate step between two screen pixels, the finest
+        // request of a frame wins
+        void Request(GLuint texture, float uvPerPixel);
+
+        // once per frame after the requests, starts loads and evictions
+        void Update();
+
+        void setBudget(double budgetMB);
+
+        size_t getResidentBytes();
+        // memory every texture would take at the level it asked for
+        size_t getRequestedBytes();
+        size_t getEvictedBytes();
+        size_t getStreamedBytes();
+
+        // levels up to this size are uploaded at load time
+        static int getInitialLevel(int width, int height, int levelCount);
+
+    private:
+        struct StreamedTexture {
+            TextureLevels levels;
+            // finest level with its data in video memory, the sampled base level
+            int residentLevel;
+            // finest level allocated, below residentLevel while its upload is in flight
+            int loadingLevel;
+            // levels whose upload has finished
+            uint32_t arrived;
+            int requestedLevel;
+            unsigned int lastUsed;
+        };
+
+        std::unordered_map<GLuint, StreamedTexture> textures;
+        TextureUploader* uploader = NULL;
+        size_t budget = 0;
+        unsigned int frame = 1;
+
+        size_t residentBytes = 0;
+        size_t requestedBytes = 0;
+        size_t evictedBytes = 0;
+        size_t streamedBytes = 0;
+
+        static size_t getLevelBytes(const TextureLevels& levels, int level);
+        void LevelArrived(GLuint texture, int level);
+        // an upload could not be issued, the levels in flight are dropped and requested again
+        void LevelFailed(GLuint texture);
+        // drops levels of other textures until bytes more fit in the budget
+        bool MakeRoom(size_t bytes, GLuint keep);
+        void Evict(StreamedTexture& texture);
+        // with the texture bound, releases the memory of a level below the base
+        static void FreeLevel(const TextureLevels& levels, int level);
+    };
+}
+
+#endif /* TextureStreamer_hpp */
@@ -0,0 +1,256 @@
+#include "TextureUploader.hpp"
+#include "RenderBackend.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace gps {
+
+    void TextureUploader::Create(int bufferCount, double frameBudgetMB) {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        slots.resize(bufferCount);
+        for (size_t i = 0; i < slots.size(); i++) {
+            backend.GenBuffers(1, &slots[i].buffer);
+            slots[i].capacity = 0;
+            slots[i].state = SLOT_FREE;
+            slots[i].fence = 0;
+        }
+        setFrameBudget(frameBudgetMB);
+    }
+
+    void TextureUploader::Delete() {
+
+        //never created, as without a GL context
+        if (slots.empty()) {
+            return;
+        }
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        for (size_t i = 0; i < slots.size(); i++) {
+
+            //a worker may still be writing into the mapping
+            if (slots[i].state == SLOT_COPYING) {
+                slots[i].copy.wait();
+                backend.BindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[i].buffer);
+                backend.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            if (slots[i].fence) {
+                backend.DeleteSync(slots[i].fence);
+            }
+            backend.DeleteBuffers(1, &slots[i].buffer);
+        }
+        backend.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        slots.clear();
+        queue.clear();
+        queuedBytes = 0;
+    }
+
+    void TextureUploader::Enqueue(const TextureUpload& upload) {
+
+        queue.push_back(upload);
+        queuedBytes += upload.size;
+    }
+
+    void TextureUploader::EnqueueLevel(const TextureLevels& levels, int level, bool generateMipmap, std::function<void(bool)> done) {
+
+        SpecifyLevel(levels, level, false);
+
+        TextureUpload upload;
+        upload.texture = levels.texture;
+        upload.level = level;
+        upload.width = std::max(1, levels.width >> level);
+        upload.height = std::max(1, levels.height >> level);
+        upload.format = levels.format;
+        upload.compressed = levels.compressed;
+        upload.generateMipmap = generateMipmap;
+        upload.data = levels.data[level];
+        upload.size = levels.sizes[level];
+        upload.owner = levels.owner;
+        upload.done = done;
+        Enqueue(upload);
+    }
+
+    void TextureUploader::SpecifyLevel(const TextureLevels& levels, int level, bool withData) {
+
+        GLsizei width = std::max(1, levels.width >> level);
+        GLsizei height = std::max(1, levels.height >> level);
+        const void* data = withData ? levels.data[level] : NULL;
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.BindTexture(GL_TEXTURE_2D, levels.texture);
+        if (levels.compressed) {
+            backend.CompressedTexImage2D(GL_TEXTURE_2D, level, levels.internalFormat, width, height, 0, (GLsizei)levels.sizes[level], data);
+        }
+        else {
+            backend.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            backend.TexImage2D(GL_TEXTURE_2D, level, levels.internalFormat, width, height, 0, levels.format, GL_UNSIGNED_BYTE, data);
+            backend.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+        backend.BindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void TextureUploader::Cancel(GLuint texture) {
+
+        for (std::deque<TextureUpload>::iterator it = queue.begin(); it != queue.end();) {
+            if (it->texture == texture) {
+                queuedBytes -= it->size;
+                it = queue.erase(it);
+            }
+            else
+                ++it;
+        }
+
+        //the copy cannot be stopped, its result is just never used
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].state == SLOT_COPYING && slots[i].upload.texture == texture)
+                slots[i].upload.texture = 0;
+        }
+    }
+
+    void TextureUploader::Update() {
+
+        if (slots.empty()) {
+            return;
+        }
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        for (size_t i = 0; i < slots.size(); i++) {
+
+            Slot& slot = slots[i];
+            if (slot.state == SLOT_COPYING && slot.copy.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                Finish(slot);
+            }
+            if (slot.state == SLOT_FENCED) {
+                GLenum status = backend.ClientWaitSync(slot.fence, 0, 0);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    backend.DeleteSync(slot.fence);
+                    slot.fence = 0;
+                    slot.state = SLOT_FREE;
+                }
+            }
+        }
+
+        //the first upload of a frame always starts so one bigger than the budget is not stuck
+        size_t startedBytes = 0;
+        for (size_t i = 0; i < slots.size() && !queue.empty(); i++) {
+
+            if (slots[i].state != SLOT_FREE) {
+                continue;
+            }
+            if (startedBytes > 0 && startedBytes + queue.front().size > frameBudget) {
+                break;
+            }
+
+            TextureUpload upload = queue.front();
+            queue.pop_front();
+            queuedBytes -= upload.size;
+            startedBytes += upload.size;
+            Begin(slots[i], upload);
+        }
+        backend.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    void TextureUploader::Begin(Slot& slot, const TextureUpload& upload) {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        if (upload.size > slot.capacity) {
+            slot.capacity = upload.size;
+        }
+        //orphaned, the previous contents may still be read by an earlier upload
+        backend.BufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, NULL, GL_STREAM_DRAW);
+        void* mapped = backend.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, upload.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+        slot.upload = upload;
+        slot.state = SLOT_COPYING;
+        if (!mapped) {
+            //nothing to wait for, Finish sees the failed copy through the null data
+            slot.upload.data = NULL;
+            std::promise<void> done;
+            done.set_value();
+            slot.copy = done.get_future();
+            return;
+        }
+
+        const void* data = upload.data;
+        size_t size = upload.size;
+        std::shared_ptr<const void> owner = upload.owner;
+        slot.copy = ThreadPool::getShared().Submit([mapped, data, size, owner]() {
+            memcpy(mapped, data, size);
+        });
+    }
+
+    void TextureUploader::Finish(Slot& slot) {
+
+        RenderBackend& backend = RenderBackend::getCurrent();
+        backend.BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        bool copied = slot.upload.data != NULL && backend.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        slot.upload.owner.reset();
+
+        TextureUpload upload = slot.upload;
+        slot.upload.done = std::function<void(bool)>();
+        if (copied && upload.texture != 0) {
+
+            backend.BindTexture(GL_TEXTURE_2D, upload.texture);
+            //with a buffer bound the data pointer is an offset into it
+            if (upload.compressed) {
+                backend.CompressedTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, 0, upload.width, upload.height,
+                    upload.format, (GLsizei)upload.size, (const void*)0);
+            }
+            else {
+                backend.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                backend.TexSubImage2D(GL_TEXTURE_2D, upload.level, 0, 0, upload.width, upload.height,
+                    upload.format, GL_UNSIGNED_BYTE, (const void*)0);
+                backend.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            }
+            if (upload.generateMipmap) {
+                backend.GenerateMipmap(GL_TEXTURE_2D);
+            }
+            backend.BindTexture(GL_TEXTURE_2D, 0);
+            uploadedBytes += upload.size;
+
+            if (upload.done) {
+                upload.done(true);
+            }
+        }
+        else if (upload.texture != 0 && upload.done) {
+            //the mapping failed, the level was allocated but holds no data
+            upload.done(false);
+        }
+
+        slot.fence = backend.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.state = SLOT_FENCED;
+    }
+
+    void TextureUploader::setFrameBudget(double frameBudgetMB) {
+
+        frameBudget = (size_t)(frameBudgetMB * 1024.0 * 1024.0);
+    }
+
+    bool TextureUploader::isIdle() {
+
+        if (!queue.empty()) {
+            return false;
+        }
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].state == SLOT_COPYING) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t TextureUploader::getQueuedBytes() {
+
+        return queuedBytes;
+    }
+
+    size_t TextureUploader::getUploadedBytes() {
+
+        return uploadedBytes;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef TextureUploader_hpp
+#define TextureUploader_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace gps {
+
+    // one level of a texture whose storage is already allocated
+    struct TextureUpload {
+        GLuint texture;
+        GLint level;
+        GLsizei width;
+        GLsizei height;
+        // internal format for compressed data, pixel format otherwise
+        GLenum format;
+        bool compressed;
+        // run glGenerateMipmap once the level is in
+        bool generateMipmap;
+        const void* data;
+        size_t size;
+        // keeps data alive until it has been copied
+        std::shared_ptr<const void> owner;
+        // called on the GL thread once the level has been issued, with false when it could not be,
+        // not for cancelled uploads
+        std::function<void(bool uploaded)> done;
+    };
+
+    // every level of a texture as it is kept in memory, level 0 first
+    struct TextureLevels {
+        GLuint texture;
+        GLint internalFormat;
+        // pixel format, or the internal format again for compressed data
+        GLenum format;
+        bool compressed;
+        int width;
+        int height;
+        std::vector<const void*> data;
+        std::vector<size_t> sizes;
+        std::shared_ptr<const void> owner;
+    };
+
+    // Streams texture data through a ring of pixel buffer objects.
+    // Workers copy the pixels into the mapped buffers, the GL thread issues TexSubImage2D from
+    // them through the RenderBackend and a fence tells when a buffer can be reused. A per frame budget spreads big loads
+    // over several frames instead of stalling one.
+    class TextureUploader {
+
+    public:
+        void Create(int bufferCount = 4, double frameBudgetMB = 32.0);
+        // waits for the copies in flight, the queued uploads are dropped
+        void Delete();
+
+        void Enqueue(const TextureUpload& upload);
+        // allocates the level now and queues its data
+        void EnqueueLevel(const TextureLevels& levels, int level, bool generateMipmap, std::function<void(bool uploaded)> done);
+
+        // (re)specifies one level of the texture, with its data or left undefined
+        static void SpecifyLevel(const TextureLevels& levels, int level, bool withData);
+
+        // drops the uploads of a texture about to be deleted
+        void Cancel(GLuint texture);
+
+        // once per frame on the GL thread: finishes copied uploads, recycles signaled buffers
+        // and starts new copies within the budget
+        void Update();
+
+        void setFrameBudget(double frameBudgetMB);
+        bool isIdle();
+        size_t getQueuedBytes();
+        size_t getUploadedBytes();
+
+    private:
+        enum SlotState {
+            SLOT_FREE,
+            SLOT_COPYING,
+            SLOT_FENCED
+        };
+
+        struct Slot {
+            GLuint buffer;
+            size_t capacity;
+            SlotState state;
+            TextureUpload upload;
+            std::future<void> copy;
+            GLsync fence;
+        };
+
+        std::vector<Slot> slots;
+        std::deque<TextureUpload> queue;
+        size_t frameBudget = 0;
+        size_t queuedBytes = 0;
+        size_t uploadedBytes = 0;
+
+        void Begin(Slot& slot, const TextureUpload& upload);
+        void Finish(Slot& slot);
+    };
+}
+
+#endif /* TextureUploader_hpp */
@@ -0,0 +1,146 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace gps {
+
+    struct ThreadPool::ParallelForState {
+        std::atomic<int> nextChunk;
+        std::atomic<int> doneChunks;
+        std::mutex mutex;
+        std::condition_variable allDone;
+        // the first exception of a chunk, thrown again on the calling thread
+        std::exception_ptr error;
+
+        ParallelForState() : nextChunk(0), doneChunks(0) {}
+    };
+
+    unsigned int ThreadPool::sharedThreadCount = 0;
+
+    ThreadPool::ThreadPool(unsigned int threadCount) {
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        stopping = false;
+        for (unsigned int i = 0; i < threadCount; i++) {
+            workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            stopping = true;
+        }
+        tasksAvailable.notify_all();
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> task) {
+
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks.push(task);
+        }
+        tasksAvailable.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+
+        while (true) {
+
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(tasksMutex);
+                tasksAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+                //remaining tasks are still run so no future is left without a value
+                if (stopping && tasks.empty()) {
+                    return;
+                }
+
+                task = tasks.front();
+                tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+    void ThreadPool::ParallelFor(int count, const std::function<void(int begin, int end)>& body) {
+
+        if (count <= 0) {
+            return;
+        }
+
+        //a few chunks per thread so uneven chunks still balance out
+        int chunkCount = std::min(count, (int)(workers.size() + 1) * 4);
+        int chunkSize = (count + chunkCount - 1) / chunkCount;
+
+        //a helper may only start once the call returned, behind long tasks, so it shares nothing
+        //with this frame but the counters, and touches body only for a chunk it claimed in time
+        std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+        const std::function<void(int begin, int end)>* chunkBody = &body;
+        std::function<void()> runChunks = [state, chunkBody, count, chunkCount, chunkSize]() {
+            int chunk;
+            while ((chunk = state->nextChunk++) < chunkCount) {
+                int begin = chunk * chunkSize;
+                int end = std::min(count, begin + chunkSize);
+                try {
+                    if (begin < end) {
+                        (*chunkBody)(begin, end);
+                    }
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (!state->error) {
+                        state->error = std::current_exception();
+                    }
+                }
+
+                if (++state->doneChunks == chunkCount) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->allDone.notify_all();
+                }
+            }
+        };
+
+        int helperCount = std::min((int)workers.size(), chunkCount - 1);
+        for (int i = 0; i < helperCount; i++) {
+            Enqueue(runChunks);
+        }
+
+        runChunks();
+
+        //every chunk is claimed now, wait for the ones still running on the helpers and not for the helpers
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->allDone.wait(lock, [&state, chunkCount]() { return state->doneChunks == chunkCount; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    unsigned int ThreadPool::getThreadCount() {
+
+        return (unsigned int)workers.size();
+    }
+
+    ThreadPool& ThreadPool::getShared() {
+
+        static ThreadPool shared(sharedThreadCount);
+        return shared;
+    }
+
+    void ThreadPool::setSharedThreadCount(unsigned int threadCount) {
+
+        sharedThreadCount = threadCount;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    // Fixed set of worker threads for CPU side work (light assignment, image decoding, ...).
+    // Tasks must not touch OpenGL, the context only lives on the main thread.
+    class ThreadPool {
+
+    public:
+        // 0 uses one thread per hardware core
+        explicit ThreadPool(unsigned int threadCount = 0);
+        ~ThreadPool();
+
+        // runs task on a worker, the future holds its result or exception
+        template <class Task>
+        std::future<typename std::result_of<Task()>::type> Submit(Task task);
+
+        // calls body(begin, end) on chunks of [0, count), the calling thread helps and
+        // the call returns once every chunk is done, without waiting for helpers that never
+        // got to start; not meant to be called from a task
+        void ParallelFor(int count, const std::function<void(int begin, int end)>& body);
+
+        unsigned int getThreadCount();
+
+        // pool shared by the whole application, created on first use
+        static ThreadPool& getShared();
+        // thread count of the shared pool, only has an effect before its first use
+        static void setSharedThreadCount(unsigned int threadCount);
+
+    private:
+        // chunk counters of one ParallelFor, shared with its helpers
+        struct ParallelForState;
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()> > tasks;
+        std::mutex tasksMutex;
+        std::condition_variable tasksAvailable;
+        bool stopping;
+
+        static unsigned int sharedThreadCount;
+
+        void Enqueue(std::function<void()> task);
+        void WorkerLoop();
+    };
+
+    template <class Task>
+    std::future<typename std::result_of<Task()>::type> ThreadPool::Submit(Task task) {
+
+        typedef typename std::result_of<Task()>::type Result;
+
+        //std::function needs a copyable callable, the packaged task is shared instead
+        std::shared_ptr<std::packaged_task<Result()> > packaged = std::make_shared<std::packaged_task<Result()> >(task);
+        std::future<Result> result = packaged->get_future();
+        Enqueue([packaged]() { (*packaged)(); });
+
+        return result;
+    }
+}
+
+#endif /* ThreadPool_hpp */
@@ -1,5 +1,8 @@
 #include "Window.h"
 
+#include <fstream>
+#include <vector>
+
 namespace gps {
 
     void Window::Create(int width, int height, const char *title) {
@@ -7,11 +10,7 @@ namespace gps {
             throw std::runtime_error("Could not start GLFW3!");
         }
 
-        //window hints
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        SetContextHints();
 
         //window scaling for HiDPI displays
         glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
@@ -31,29 +30,160 @@ namespace gps {
 
         glfwSwapInterval(1);
 
+        if (!InitContext()) {
+            throw std::runtime_error("Could not load the OpenGL functions!");
+        }
+
+        //for RETINA display
+        glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
+    }
+
+    void Window::CreateHeadless(int width, int height) {
+        this->headless = true;
+
+#if defined (GLFW_PLATFORM_NULL)
+        //no display needed at all, EGL first as it can still use a GPU, then OSMesa
+        const int contextApis[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+        for (int i = 0; i < 2 && !this->window; i++) {
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+            if (!glfwInit()) {
+                break;
+            }
+            SetContextHints();
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextApis[i]);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            this->window = glfwCreateWindow(width, height, "", NULL, NULL);
+            if (this->window) {
+                //a GLEW built for GLX cannot load functions on these contexts, the next one is tried then
+                glfwMakeContextCurrent(window);
+                if (InitContext()) {
+                    break;
+                }
+                glfwDestroyWindow(window);
+                this->window = NULL;
+            }
+            glfwTerminate();
+        }
+        glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+#endif
+
+        //a hidden window of the default platform when none of the above worked
+        if (!this->window) {
+            if (!glfwInit()) {
+                throw std::runtime_error("Could not start GLFW3!");
+            }
+            SetContextHints();
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            this->window = glfwCreateWindow(width, height, "", NULL, NULL);
+            if (!this->window) {
+                throw std::runtime_error("Could not create an offscreen context!");
+            }
+            glfwMakeContextCurrent(window);
+            if (!InitContext()) {
+                throw std::runtime_error("Could not load the OpenGL functions!");
+            }
+        }
+
+        //nothing to wait for without a display
+        glfwSwapInterval(0);
+
+        CreateFramebuffer(width, height);
+
+        this->dimensions.width = width;
+        this->dimensions.height = height;
+    }
+
+    void Window::SetContextHints() {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    }
+
+    bool Window::InitContext() {
 #if not defined (__APPLE__)
         // start GLEW extension handler
         glewExperimental = GL_TRUE;
-        glewInit();
+        if (glewInit() != GLEW_OK || !glGenFramebuffers) {
+            return false;
+        }
 #endif
 
-        // get version info
+        // get version info, the strings can be NULL on a broken context
         const GLubyte* renderer = glGetString(GL_RENDERER); // get renderer string
         const GLubyte* version = glGetString(GL_VERSION); // version as a string
-        std::cout << "Renderer: " << renderer << std::endl;
-        std::cout << "OpenGL version: " << version << std::endl;
+        if (renderer)
+            std::cout << "Renderer: " << renderer << std::endl;
+        if (version)
+            std::cout << "OpenGL version: " << version << std::endl;
+        return true;
+    }
 
-        //for RETINA display
-        glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
+    void Window::CreateFramebuffer(int width, int height) {
+        //sRGB like the window, so GL_FRAMEBUFFER_SRGB encodes the same way
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Could not create the offscreen framebuffer!");
+        }
     }
 
     void Window::Delete() {
+        if (framebuffer) {
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+        }
         if (window)
             glfwDestroyWindow(window);
         //close GL context and any other GLFW resources
         glfwTerminate();
     }
 
+    void Window::SwapBuffers() {
+        //the driver still gets the frame, so a headless loop cannot run ahead of it
+        if (headless)
+            glFlush();
+        else
+            glfwSwapBuffers(window);
+    }
+
+    bool Window::SaveFrame(const std::string& fileName) {
+        int width = this->dimensions.width;
+        int height = this->dimensions.height;
+        std::vector<unsigned char> pixels((size_t)width * height * 3);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, pixels.data());
+
+        //uncompressed true color, rows from the bottom like GL reads them
+        unsigned char header[18] = { 0 };
+        header[2] = 2;
+        header[12] = width & 0xFF;
+        header[13] = (width >> 8) & 0xFF;
+        header[14] = height & 0xFF;
+        header[15] = (height >> 8) & 0xFF;
+        header[16] = 24;
+
+        std::ofstream file(fileName, std::ios::binary);
+        file.write((const char*)header, sizeof(header));
+        file.write((const char*)pixels.data(), pixels.size());
+        return file.good();
+    }
+
     GLFWwindow* Window::getWindow() {
         return this->window;
     }
@@ -65,4 +195,12 @@ namespace gps {
     void Window::setWindowDimensions(WindowDimensions dimensions) {
         this->dimensions = dimensions;
     }
+
+    GLuint Window::getFramebuffer() {
+        return this->framebuffer;
+    }
+
+    bool Window::isHeadless() {
+        return this->headless;
+    }
 }
@@ -13,6 +13,7 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <string>
 
 struct WindowDimensions {
     int width;
@@ -25,15 +26,37 @@ namespace gps {
 
     public:
         void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        //nothing on screen, the frames go to a framebuffer object of that size
+        //the context is EGL without a surface or OSMesa where GLFW has its null platform (3.4),
+        //these run on Mesa llvmpipe without a GPU or a display, otherwise a hidden window
+        void CreateHeadless(int width, int height);
         void Delete();
 
+        //shows the frame, or only flushes it when headless
+        void SwapBuffers();
+        //the frame drawn so far as an uncompressed 24 bit TGA, call it before SwapBuffers()
+        bool SaveFrame(const std::string& fileName);
+
         GLFWwindow* getWindow();
         WindowDimensions getWindowDimensions();
         void setWindowDimensions(WindowDimensions dimensions);
+        //what the scene is drawn into, 0 for the window
+        GLuint getFramebuffer();
+        bool isHeadless();
 
     private:
         WindowDimensions dimensions;
-        GLFWwindow *window;
+        GLFWwindow *window = NULL;
+        bool headless = false;
+        GLuint framebuffer = 0;
+        GLuint colorBuffer = 0;
+        GLuint depthBuffer = 0;
+
+        //the GL 4.1 core context every window asks for
+        void SetContextHints();
+        //GL function pointers and version info, with the new context current, false when they cannot be loaded
+        bool InitContext();
+        void CreateFramebuffer(int width, int height);
     };
 }
 
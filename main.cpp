@@ -17,14 +17,43 @@
 #include "Window.h"
 #include "Shader.hpp"
 #include "Camera.hpp"
+#include "CameraPath.hpp"
 #include "Model3D.hpp"
 #include "Skybox.hpp"
+#include "GpuTimer.hpp"
+#include "FrameBenchmark.hpp"
+#include "InputLog.hpp"
+#include "ProgramCache.hpp"
+#include "LightClusters.hpp"
+#include "TextureManager.hpp"
+#include "TextureUploader.hpp"
+#include "TextureStreamer.hpp"
+#include "MaterialTextures.hpp"
+#include "TexturePreprocess.hpp"
+#include "ThreadPool.hpp"
+#include "RenderBackend.hpp"
+#include "NullRenderBackend.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
 
 // window
 gps::Window myWindow;
 
+// counts the commands of every frame in place of a context, see parseArguments()
+gps::NullRenderBackend nullBackend;
+bool nullRenderer = false;
+const int NULL_RENDERER_FRAMES = 600;
+// the frame the counts were last reset at
+int nullStatsFrame = 0;
+// set by requestExit(), there is no window to close without a context
+bool exitRequested = false;
+// the seconds glfwGetTime() would count, glfw is not initialized without a window
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
 // matrices
 glm::mat4 model;
 glm::mat4 view;
@@ -35,20 +64,9 @@ glm::mat3 normalMatrix;
 glm::vec3 lightDir;
 glm::vec3 lightColor;
 
-// shader uniform locations
-GLint modelLoc;
-GLint viewLoc;
-GLint projectionLoc;
-GLint normalMatrixLoc;
-GLint lightDirLoc;
-GLint lightColorLoc;
-GLint fogDensityLoc;
-GLint flashLoc;
-GLint cutOffLoc;
-GLint outerCutOffLoc;
-GLint camFrontDirLoc;
-GLint camPosLoc;
-GLint greyLoc;
+// light direction as sent to the shader, see applyFrameUniforms()
+glm::vec3 lightDirUniform;
+glm::mat4 lightSpaceMatrix;
 
 // camera
 gps::Camera myCamera(
@@ -56,9 +74,9 @@ gps::Camera myCamera(
 	glm::vec3(0.0f, 0.0f, -10.0f),
 	glm::vec3(0.0f, 1.0f, 0.0f));
 bool cameraTour;
-int step = 0;
-int it = 0;
-float tourSpeed;
+// keyframed flight over the scene, played from the frame times so any frame rate flies it the same
+gps::CameraPath tourPath;
+double tourTime = 0.0;
 
 GLfloat cameraSpeed = 0.1f;
 GLfloat baseCameraSpeed = 5.0f;
@@ -85,11 +103,26 @@ gps::Model3D flake;
 GLfloat angle;
 float asteroidRotY = 45.0f;
 float earthRotY = 90.0f;
+// model matrices of the animated objects, see updateAnimations()
+glm::mat4 asteroidModel;
+glm::mat4 earthModel;
 
 // shaders
 gps::Shader basicShader;
 gps::Shader skyboxShader;
+gps::Shader skyboxTriangleShader;
 gps::Shader depthMapShader;
+gps::Shader depthPrepassShader;
+
+// depth prepass
+bool depthPrepass = false;
+gps::GpuTimer scenePassTimer;
+// the skybox alone, to compare the fullscreen triangle with the cube
+gps::GpuTimer skyboxTimer;
+bool skyboxTriangle = true;
+double timerReportTime = 0.0;
+// the GPU times, streaming, uploads and clusters every 2 seconds, see parseArguments()
+bool timingReport = false;
 
 //shadows
 GLuint shadowMapFBO;
@@ -101,13 +134,9 @@ glm::mat4 lightRotation;
 
 // fullsecreen toggle
 bool fullscreen;
-float aspectRatio;
-
-// field of view
-float fov = 45.0f;
 
-// fog density
-float fogDensity = 0.01f;
+// fog density, 0 selects the shader variant without fog
+float fogDensity = 0.0f;
 
 // light 
 float lightSpeed = 0.7f;
@@ -122,9 +151,81 @@ bool flash = false;
 bool grey = false;
 bool snow = false;
 
+// clustered point lights
+gps::LightClusters lightClusters;
+std::vector<gps::PointLight> sceneLights;
+// lamps and beacons around the base, blink phase in the intensity field
+std::vector<gps::PointLight> baseLights;
+// 1k random lights for the stress scene
+std::vector<gps::PointLight> stressLights;
+bool clusteredLighting = false;
+bool lightStress = false;
+
+// texture data goes through a PBO ring, at most this much per frame
+gps::TextureUploader textureUploader;
+const double TEXTURE_UPLOAD_BUDGET_MB = 32.0;
+
+// mip levels are streamed in as the camera gets close, within this much video memory
+gps::TextureStreamer textureStreamer;
+double textureBudgetMB = 256.0;
+
+// textures of the scene pass in arrays or bindless handles instead of per draw binds
+gps::MaterialTextures materialTextures;
+bool materialTexturesEnabled = false;
+// units after the cluster buffers
+const GLuint MATERIAL_TEXTURE_UNIT = 7;
+
+// build the texture caches and exit, see parseArguments()
+bool transcodeOnly = false;
+// time the pixel passes of texture loading and exit
+bool textureBenchmark = false;
+
+// window size, and no window at all for automated runs, see parseArguments()
+int windowWidth = 1024;
+int windowHeight = 768;
+bool headless = false;
+// frames written as PREFIX000001.tga and so on, empty for none
+std::string frameDumpPrefix;
+// ends the run after that many frames, 0 runs until closed or the benchmark path is flown once
+int frameLimit = 0;
+int frameIndex = 0;
+
+// fly a camera path at a fixed time step and write the frame times, see parseArguments()
+std::string benchmarkPathFile;
+std::string benchmarkOutput = "benchmark.json";
+bool benchmarking = false;
+// false while the warm up frames wait for the loading to finish
+bool benchmarkRecording = false;
+int benchmarkWarmupFrames = 0;
+gps::CameraPath benchmarkPath;
+gps::FrameBenchmark frameBenchmark;
+// simulated seconds per frame, the same frames on every machine
+const double BENCHMARK_STEP = 1.0 / 60.0;
+const unsigned int BENCHMARK_SEED = 1234;
+const int BENCHMARK_MAX_WARMUP_FRAMES = 600;
+
+// the frame times and input events of a session written to a binary log, or played back from one, see parseArguments()
+gps::InputLog inputLog;
+std::string inputRecordFile;
+std::string inputReplayFile;
+double clusterAssignMs = 0.0;
+double clusterUploadMs = 0.0;
+int clusterFrames = 0;
+
 // skybox
 gps::SkyBox skyBox;
 std::vector<const GLchar*> faces;
+// the shipped cube maps, faces in GL order: right, left, top, bottom, back, front
+const GLchar* skyBoxFaceSets[][6] = {
+	{ "skybox/starfield/starfield_rt.tga", "skybox/starfield/starfield_lf.tga", "skybox/starfield/starfield_up.tga",
+	  "skybox/starfield/starfield_dn.tga", "skybox/starfield/starfield_bk.tga", "skybox/starfield/starfield_ft.tga" },
+	{ "skybox/nightsky/nightsky_rt.tga", "skybox/nightsky/nightsky_lf.tga", "skybox/nightsky/nightsky_up.tga",
+	  "skybox/nightsky/nightsky_dn.tga", "skybox/nightsky/nightsky_bk.tga", "skybox/nightsky/nightsky_ft.tga" },
+	{ "skybox/midnight-silence/midnight-silence_rt.tga", "skybox/midnight-silence/midnight-silence_lf.tga", "skybox/midnight-silence/midnight-silence_up.tga",
+	  "skybox/midnight-silence/midnight-silence_dn.tga", "skybox/midnight-silence/midnight-silence_bk.tga", "skybox/midnight-silence/midnight-silence_ft.tga" }
+};
+const int SKYBOX_COUNT = sizeof(skyBoxFaceSets) / sizeof(skyBoxFaceSets[0]);
+const float SKYBOX_FADE_SECONDS = 1.5f;
 
 #define MAX_PARTICLES 3000
 struct Particle {
@@ -138,6 +239,9 @@ struct Particle {
 	float windVelocity;
 };
 Particle particles[MAX_PARTICLES];
+// per flake model matrices for the instanced draw
+GLuint flakeInstanceVBO;
+glm::mat4 flakeModels[MAX_PARTICLES];
 float slowdown = 2.0f;
 bool windN = false, windS = false, windE = false, windV = false;
 
@@ -145,7 +249,7 @@ bool windN = false, windS = false, windE = false, windV = false;
 GLenum glCheckError_(const char* file, int line)
 {
 	GLenum errorCode;
-	while ((errorCode = glGetError()) != GL_NO_ERROR) {
+	while ((errorCode = gps::RenderBackend::getCurrent().GetError()) != GL_NO_ERROR) {
 		std::string error;
 		switch (errorCode) {
 		case GL_INVALID_ENUM:
@@ -170,22 +274,35 @@ GLenum glCheckError_(const char* file, int line)
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
 
+// ends the application loop after the current frame
+void requestExit() {
+	exitRequested = true;
+	if (myWindow.getWindow())
+		glfwSetWindowShouldClose(myWindow.getWindow(), GL_TRUE);
+}
+
+double getTime() {
+	if (nullRenderer)
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return glfwGetTime();
+}
+
 
 void initStarfield() {
-	faces.push_back("skybox/starfield/starfield_rt.tga"); //right
-	faces.push_back("skybox/starfield/starfield_lf.tga"); //left
-	faces.push_back("skybox/starfield/starfield_up.tga"); //top
-	faces.push_back("skybox/starfield/starfield_dn.tga"); //bottom
-	faces.push_back("skybox/starfield/starfield_bk.tga"); //back   
-	faces.push_back("skybox/starfield/starfield_ft.tga"); //front
+	faces.assign(skyBoxFaceSets[0], skyBoxFaceSets[0] + 6);
 
 	skyBox.Load(faces);
+
+	// the other skyboxes load in the background, K switches between them
+	for (int i = 1; i < SKYBOX_COUNT; i++) {
+		skyBox.Preload(skyBox.Add(std::vector<const GLchar*>(skyBoxFaceSets[i], skyBoxFaceSets[i] + 6)));
+	}
 }
 
 void viewModes(GLFWwindow* window, int key, int action) {
 
 	// fullscreen
-	if (pressedKeys[GLFW_KEY_F11]) {
+	if (pressedKeys[GLFW_KEY_F11] && window) {
 		fullscreen = !fullscreen;
 		if (fullscreen) {
 			GLFWmonitor* monitor = glfwGetPrimaryMonitor();
@@ -200,23 +317,23 @@ void viewModes(GLFWwindow* window, int key, int action) {
 
 	// view edges between vertices ( lines )
 	if (pressedKeys[GLFW_KEY_6]) {
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		gps::RenderBackend::getCurrent().PolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	}
 
 	// view vertices ( points )
 	if (pressedKeys[GLFW_KEY_7]) {
-		glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+		gps::RenderBackend::getCurrent().PolygonMode(GL_FRONT_AND_BACK, GL_POINT);
 	}
 
 	// default view
 	if (pressedKeys[GLFW_KEY_8]) {
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		gps::RenderBackend::getCurrent().PolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	}
 
 	// scene tour
 	if (pressedKeys[GLFW_KEY_1]) {
-		step = 0;
-		cameraTour = !cameraTour;
+		tourTime = 0.0;
+		cameraTour = !cameraTour && tourPath.getKeyframeCount() > 0;
 	}
 
 
@@ -234,6 +351,29 @@ void initFlakes(int i) {
 
 }
 
+void initFlakeInstances() {
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	backend.GenBuffers(1, &flakeInstanceVBO);
+	backend.BindBuffer(GL_ARRAY_BUFFER, flakeInstanceVBO);
+	backend.BufferData(GL_ARRAY_BUFFER, sizeof(flakeModels), NULL, GL_STREAM_DRAW);
+	backend.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	flake.setInstanceBuffer(flakeInstanceVBO);
+}
+
+void uploadFlakeInstances() {
+	for (int i = 0; i < MAX_PARTICLES; ++i) {
+		flakeModels[i] = glm::translate(glm::mat4(1.0f), particles[i].position);
+	}
+
+	// orphan the old storage so the driver does not wait for last frame's draws
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	backend.BindBuffer(GL_ARRAY_BUFFER, flakeInstanceVBO);
+	backend.BufferData(GL_ARRAY_BUFFER, sizeof(flakeModels), NULL, GL_STREAM_DRAW);
+	backend.BufferSubData(GL_ARRAY_BUFFER, 0, sizeof(flakeModels), flakeModels);
+	backend.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 float windSpeed = 2.2f;
 void updateFlakes(float deltaTime) {
 	for (int i = 0; i < MAX_PARTICLES; ++i) {
@@ -278,43 +418,41 @@ void moveLight() {
 
 	if (pressedKeys[GLFW_KEY_KP_8]) {
 		lightDir.y -= lightSpeed;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_5]) {
 		lightDir.y += lightSpeed;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_4]) {
 		lightDir.x -= lightSpeed;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_6]) {
 		lightDir.x += lightSpeed;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_1]) {
 		lightDir.z -= lightSpeed;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_3]) {
 		lightDir.z += lightSpeed;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_7]) {
 		lightDir = glm::vec3(-9.09f, 9.39f, -1.80f);
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
 	if (pressedKeys[GLFW_KEY_KP_9]) {
 		grey = !grey;
-		glUniform1i(greyLoc, grey);
-
 	}
 }
 
@@ -324,18 +462,55 @@ void windowResizeCallback(GLFWwindow* window, int width, int height) {
 	WindowDimensions newWindowSize = WindowDimensions{ width, height };
 	myWindow.setWindowDimensions(newWindowSize);
 
-	aspectRatio = (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height;
-	projection = glm::perspective(glm::radians(fov), aspectRatio, 0.1f, 100.0f);
-	projectionLoc = glGetUniformLocation(basicShader.shaderProgram, "projection");
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+	// the projection is read from the camera with the next frame
+	if (height > 0)
+		myCamera.setAspect((float)width / (float)height);
 
-	glViewport(0, 0, width, height);
+	gps::RenderBackend::getCurrent().Viewport(0, 0, width, height);
 
 }
 
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-		glfwSetWindowShouldClose(window, GL_TRUE);
+		requestExit();
+	}
+
+	// the benchmark scene does not change with input
+	if (benchmarking)
+		return;
+
+	// clustered point lights
+	if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+		clusteredLighting = !clusteredLighting;
+		scenePassTimer.Reset();
+		std::cout << "Clustered lighting " << (clusteredLighting ? "on" : "off") << std::endl;
+	}
+
+	if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+		lightStress = !lightStress;
+		scenePassTimer.Reset();
+		std::cout << "Light stress scene " << (lightStress ? "on" : "off") << std::endl;
+	}
+
+	// fullscreen triangle or cube skybox
+	if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+		skyboxTriangle = !skyboxTriangle;
+		skyboxTimer.Reset();
+		std::cout << "Skybox drawn as " << (skyboxTriangle ? "a fullscreen triangle" : "a cube") << std::endl;
+	}
+
+	// next skybox, faded in once it is loaded
+	if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+		int next = (skyBox.getSelected() + 1) % skyBox.getCount();
+		skyBox.Select(next, SKYBOX_FADE_SECONDS);
+		std::cout << "Skybox " << skyBoxFaceSets[next][0] << (skyBox.isLoaded(next) ? "" : " (loading)") << std::endl;
+	}
+
+	// depth prepass
+	if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+		depthPrepass = !depthPrepass;
+		scenePassTimer.Reset();
+		std::cout << "Depth prepass " << (depthPrepass ? "on" : "off") << std::endl;
 	}
 
 	if (key >= 0 && key < 1024) {
@@ -356,25 +531,23 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
 		myCamera.reset();
 		//update view matrix
 		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 	}
 
 	// fog
 	if (pressedKeys[GLFW_KEY_B]) {
 		fogDensity += 0.01f;
-		glUniform1f(fogDensityLoc, fogDensity);
 	}
 
 	if (pressedKeys[GLFW_KEY_V]) {
 		fogDensity -= 0.01f;
-		glUniform1f(fogDensityLoc, fogDensity);
+		// no fog at all switches to the variant without it
+		if (fogDensity < 0.005f)
+			fogDensity = 0.0f;
 	}
 
 	// flashlight
 	if (pressedKeys[GLFW_KEY_F]) {
 		flash = !flash;
-		glUniform1i(flashLoc, flash);
 	}
 
 	// snow
@@ -402,28 +575,41 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
 }
 
 void processDeltaSpeed() {
-	currentTime = glfwGetTime();
-	deltaTime = currentTime - lastTime;
+	if (benchmarking) {
+		// simulated time, nothing moves during the warm up
+		currentTime = frameBenchmark.getRecordedFrames() * BENCHMARK_STEP;
+		deltaTime = benchmarkRecording ? BENCHMARK_STEP : 0.0;
+	}
+	else if (inputLog.isReplaying()) {
+		// the recorded frame times, the events of each frame then find the scene as it was
+		if (!inputLog.NextFrame(currentTime)) {
+			currentTime = lastTime;
+			requestExit();
+		}
+		deltaTime = currentTime - lastTime;
+	}
+	else {
+		currentTime = getTime();
+		deltaTime = currentTime - lastTime;
+	}
 	lastTime = currentTime;
 
-	aspectRatio = (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height;
-	cameraSpeed = baseCameraSpeed * aspectRatio * deltaTime;
+	if (inputLog.isRecording())
+		inputLog.WriteFrame(currentTime);
+
+	cameraSpeed = baseCameraSpeed * myCamera.getAspect() * deltaTime;
 }
 
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
-	fov -= (float)yoffset;
+	float fov = myCamera.getFov() - (float)yoffset;
 	if (fov < 1.0f)
 		fov = 1.0f;
 	if (fov > 90.0f)
 		fov = 90.0f;
+	myCamera.setFov(fov);
 
-	aspectRatio = (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height;
-	projection = glm::perspective(glm::radians(fov), aspectRatio, 0.1f, 100.0f);
-	projectionLoc = glGetUniformLocation(basicShader.shaderProgram, "projection");
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-	glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+	gps::RenderBackend::getCurrent().Viewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
 }
 
 void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
@@ -453,170 +639,133 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 		pitch = -89.0f;
 
 	myCamera.rotate(pitch, yaw);
-	view = myCamera.getViewMatrix();
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-	normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
 
 	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
-		fov = 15.0f;
+		myCamera.setFov(15.0f);
 	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE)
-		fov = 45.0f;
-
-	aspectRatio = (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height;
-	projection = glm::perspective(glm::radians(fov), aspectRatio, 0.1f, 100.0f);
-	projectionLoc = glGetUniformLocation(basicShader.shaderProgram, "projection");
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+		myCamera.setFov(45.0f);
 }
 
-void sceneTour() {
-
-	std::cout << it << std::endl;
-
-	tourSpeed = cameraSpeed * 0.2f;
-	// part 1
-	if (step == 0) {
-		myCamera.setPosition(glm::vec3(18.0f, 1.0f, 14.0f));
-		myCamera.setFront(glm::vec3(-0.58f, -0.12f, -0.80));
-		it++;
-		if (it > 10) {
-			it = 0;
-			step++;
-		}
-	}
-	if (step == 1) {
-		myCamera.move(gps::MOVE_LEFT, tourSpeed);
-		it++;
-		if (it > 460 * 2) {
-			it = 0;
-			step++;
-		}
+// runs the callback an event was recorded from
+void dispatchInput(const gps::InputEvent& event) {
+	GLFWwindow* window = myWindow.getWindow();
+	switch (event.type) {
+	case gps::INPUT_KEY:
+		keyboardCallback(window, event.code, event.scancode, event.action, event.mods);
+		break;
+	case gps::INPUT_MOUSE_BUTTON:
+		mouseButtonCallback(window, event.code, event.action, event.mods);
+		break;
+	case gps::INPUT_CURSOR:
+		mouseCallback(window, event.x, event.y);
+		break;
+	case gps::INPUT_SCROLL:
+		scrollCallback(window, event.x, event.y);
+		break;
+	case gps::INPUT_FRAME:
+		break;
 	}
+}
 
-	// part 2
-	if (step == 2) {
-		myCamera.setPosition(glm::vec3(-9.274306f, -0.943014f, 1.866937f));
-		myCamera.setFront(glm::vec3(0.327038f, -0.033155f, -0.944429f));
-		it++;
-		if (it > 10) {
-			it = 0;
-			step++;
-		}
-	}
-	if (step == 3) {
-		myCamera.move(gps::MOVE_RIGHT, tourSpeed);
-		it++;
-		if (it > 400 * 2) {
-			it = 0;
-			step++;
-		}
+// every GLFW input callback ends here, the event is logged before it changes anything
+void receiveInput(const gps::InputEvent& event) {
+	if (inputLog.isReplaying()) {
+		// the log drives the scene, Esc still quits
+		if (event.type == gps::INPUT_KEY && event.code == GLFW_KEY_ESCAPE && event.action == GLFW_PRESS)
+			requestExit();
+		return;
 	}
 
-	// part 3
-	if (step == 4) {
-		myCamera.setPosition(glm::vec3(1.406184f, -0.910371f, -0.164452));
-		myCamera.setFront(glm::vec3(-0.998873f, -0.027922f, 0.038373f));
-		it++;
-		if (it > 10) {
-			it = 0;
-			step++;
-		}
-	}
-	if (step == 5) {
-		myCamera.move(gps::MOVE_BACKWARD, tourSpeed);
-		it++;
-		if (it > 450 * 2) {
-			it = 0;
-			step = 0;
-		}
-	}
+	if (inputLog.isRecording())
+		inputLog.Write(event);
+	dispatchInput(event);
+}
+
+void keyInput(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	gps::InputEvent event = { gps::INPUT_KEY, key, scancode, action, mods, 0.0, 0.0 };
+	receiveInput(event);
+}
+
+void mouseButtonInput(GLFWwindow* window, int button, int action, int mods) {
+	gps::InputEvent event = { gps::INPUT_MOUSE_BUTTON, button, 0, action, mods, 0.0, 0.0 };
+	receiveInput(event);
+}
+
+void cursorInput(GLFWwindow* window, double xpos, double ypos) {
+	gps::InputEvent event = { gps::INPUT_CURSOR, 0, 0, 0, 0, xpos, ypos };
+	receiveInput(event);
+}
+
+void scrollInput(GLFWwindow* window, double xoffset, double yoffset) {
+	gps::InputEvent event = { gps::INPUT_SCROLL, 0, 0, 0, 0, xoffset, yoffset };
+	receiveInput(event);
+}
+
+// the window events, then the ones this frame received when it was recorded
+void pollInput() {
+	if (myWindow.getWindow())
+		glfwPollEvents();
 
+	gps::InputEvent event;
+	while (inputLog.isReplaying() && inputLog.NextEvent(event))
+		dispatchInput(event);
+}
+
+void sceneTour() {
+	tourTime += deltaTime;
+	tourPath.Apply(myCamera, tourTime);
 }
 
 void processMovement() {
 
+	if (benchmarking) {
+		benchmarkPath.Apply(myCamera, currentTime);
+		return;
+	}
+
 	if (cameraTour) {
 		sceneTour();
 	}
 
 	if (pressedKeys[GLFW_KEY_W]) {
 		myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
-		//update view matrix
-		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		// compute normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_S]) {
 		myCamera.move(gps::MOVE_BACKWARD, cameraSpeed);
-		//update view matrix
-		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		// compute normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_A]) {
 		myCamera.move(gps::MOVE_LEFT, cameraSpeed);
-		//update view matrix
-		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		// compute normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_D]) {
 		myCamera.move(gps::MOVE_RIGHT, cameraSpeed);
-		//update view matrix
-		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		// compute normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_SPACE]) {
 		myCamera.move(gps::MOVE_UP, cameraSpeed);
-		//update view matrix
-		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		// compute normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 
 	if (pressedKeys[GLFW_KEY_LEFT_CONTROL]) {
 		myCamera.move(gps::MOVE_DOWN, cameraSpeed);
-		//update view matrix
-		view = myCamera.getViewMatrix();
-		basicShader.useShaderProgram();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		// compute normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_Q]) {
 		angle -= 1.0f;
 		// update model matrix for teapot
 		model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0, 1, 0));
-		// update normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_E]) {
 		angle += 1.0f;
 		// update model matrix for teapot
 		model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0, 1, 0));
-		// update normal matrix for teapot
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 	}
 
 	if (pressedKeys[GLFW_KEY_LEFT_SHIFT]) {
@@ -629,30 +778,51 @@ void processMovement() {
 }
 
 void initOpenGLWindow() {
-	myWindow.Create(1024, 768, "OpenGL Project Core");
+	if (headless)
+		myWindow.CreateHeadless(windowWidth, windowHeight);
+	else
+		myWindow.Create(windowWidth, windowHeight, "OpenGL Project Core");
 }
 
 void setWindowCallbacks() {
 	glfwSetWindowSizeCallback(myWindow.getWindow(), windowResizeCallback);
-	glfwSetKeyCallback(myWindow.getWindow(), keyboardCallback);
-	glfwSetCursorPosCallback(myWindow.getWindow(), mouseCallback);
-	glfwSetScrollCallback(myWindow.getWindow(), scrollCallback);
-	glfwSetMouseButtonCallback(myWindow.getWindow(), mouseButtonCallback);
+	glfwSetKeyCallback(myWindow.getWindow(), keyInput);
+	// the camera path owns the camera, Esc still quits
+	if (benchmarking)
+		return;
+	glfwSetCursorPosCallback(myWindow.getWindow(), cursorInput);
+	glfwSetScrollCallback(myWindow.getWindow(), scrollInput);
+	glfwSetMouseButtonCallback(myWindow.getWindow(), mouseButtonInput);
 	glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
 
 void initOpenGLState() {
-	glClearColor(0.7f, 0.7f, 0.7f, 1.0f);
-	glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
-	glEnable(GL_FRAMEBUFFER_SRGB);
-	glEnable(GL_DEPTH_TEST); // enable depth-testing
-	glDepthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
-	glEnable(GL_CULL_FACE); // cull face
-	glCullFace(GL_BACK); // cull back face
-	glFrontFace(GL_CCW); // GL_CCW for counter clock-wise
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	backend.ClearColor(0.7f, 0.7f, 0.7f, 1.0f);
+	backend.Viewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+	backend.Enable(GL_FRAMEBUFFER_SRGB);
+	backend.Enable(GL_TEXTURE_CUBE_MAP_SEAMLESS); // the skybox mips filter across face edges
+	backend.Enable(GL_DEPTH_TEST); // enable depth-testing
+	backend.DepthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
+	backend.Enable(GL_CULL_FACE); // cull face
+	backend.CullFace(GL_BACK); // cull back face
+	backend.FrontFace(GL_CCW); // GL_CCW for counter clock-wise
 }
 
+// material library and texture directory of every model in the scene
+const char* materialLibraries[][2] = {
+	{ "models/unmovable/unmovable.mtl", "models/unmovable/" },
+	{ "models/asteroid/asteroid1.mtl", "models/asteroid/" },
+	{ "models/earth/earth.mtl", "models/earth/" },
+	{ "models/landscape/landscape.mtl", "models/landscape/" },
+	{ "models/flake/flakeu.mtl", "models/flake/" }
+};
+
 void initModels() {
+	// texture decoding for every model starts on the workers before the first one is parsed
+	for (size_t i = 0; i < sizeof(materialLibraries) / sizeof(materialLibraries[0]); i++)
+		gps::Model3D::PrefetchTextures(materialLibraries[i][0], materialLibraries[i][1]);
+
 	unmovable.LoadModel("models/unmovable/unmovable.obj", "models/unmovable/");
 
 	asteroid1.LoadModel("models/asteroid/asteroid1.obj", "models/asteroid/");
@@ -665,7 +835,39 @@ void initModels() {
 
 }
 
+void initMaterialTextures() {
+	std::vector<gps::Model3D*> models = { &landscape, &unmovable, &asteroid1, &earth, &flake };
+	gps::MaterialMode mode = materialTextures.Create(models, true);
+
+	// basic.frag reads the material buffer in every variant
+	basicShader.setDefines(materialTextures.getShaderDefines());
+
+	std::cout << "Material textures (" << (mode == gps::MATERIALS_BINDLESS ? "bindless" : "arrays") << "): "
+		<< materialTextures.getMaterialCount() << " materials, " << materialTextures.getArrayCount() << " arrays, "
+		<< materialTextures.getUnassignedCount() << " meshes still binding per draw" << std::endl;
+}
+
+// the features basic.frag is compiled with for the current scene state
+unsigned int basicShaderFeatures() {
+	unsigned int features = gps::SHADER_SHADOWS;
+	if (flash)
+		features |= gps::SHADER_FLASH;
+	if (grey)
+		features |= gps::SHADER_GREY;
+	if (fogDensity > 0.0f)
+		features |= gps::SHADER_FOG;
+	if (clusteredLighting)
+		features |= gps::SHADER_CLUSTERED;
+
+	return features;
+}
+
 void initShaders() {
+	double setupStart = getTime();
+
+	if (gps::Shader::initParallelCompile())
+		std::cout << "Compiling shader variants in parallel" << std::endl;
+
 	basicShader.loadShader(
 		"shaders/basic.vert",
 		"shaders/basic.frag");
@@ -675,88 +877,175 @@ void initShaders() {
 	skyboxShader.loadShader(
 		"shaders/skyboxShader.vert",
 		"shaders/skyboxShader.frag");
-	skyboxShader.useShaderProgram();
+	skyboxTriangleShader.loadShader(
+		"shaders/skyboxTriangle.vert",
+		"shaders/skyboxTriangle.frag");
+	depthPrepassShader.loadShader(
+		"shaders/depthPrepass.vert",
+		"shaders/depthMap.frag");
+
+	// every variant the toggles can reach is submitted now and finishes in the background,
+	// without parallel compile they are left to their first use
+	std::vector<unsigned int> basicVariants;
+	for (unsigned int features = 0; features < (gps::SHADER_CLUSTERED << 1); features++) {
+		if (features & gps::SHADER_SHADOWS)
+			basicVariants.push_back(features);
+	}
+	basicShader.submitVariants(basicVariants);
+	depthMapShader.submitVariants({ gps::SHADER_INSTANCED });
+	depthPrepassShader.submitVariants({ gps::SHADER_INSTANCED });
+
+	// warm: everything loaded from the program cache, cold: anything compiled from source or no cache at all
+	gps::ProgramCache& programCache = gps::ProgramCache::getInstance();
+	bool warm = programCache.isEnabled() && programCache.getHits() > 0 && programCache.getMisses() == 0;
+	std::cout << "Shader setup (" << (warm ? "warm" : "cold") << "): "
+		<< (getTime() - setupStart) * 1000.0 << " ms, "
+		<< programCache.getHits() << " cached, " << programCache.getMisses() << " compiled, "
+		<< basicShader.getPendingCount() + depthMapShader.getPendingCount() + depthPrepassShader.getPendingCount()
+		<< " still linking" << std::endl;
+}
+
+void pollShaders() {
+	basicShader.pollVariants();
+	depthMapShader.pollVariants();
+	depthPrepassShader.pollVariants();
+	skyboxShader.pollVariants();
+	skyboxTriangleShader.pollVariants();
 }
 
 void initFBO() {
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
 
-	glGenFramebuffers(1, &shadowMapFBO);
+	backend.GenFramebuffers(1, &shadowMapFBO);
 
 	//create depth texture for FBO
-	glGenTextures(1, &depthMapTexture);
-	glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
+	backend.GenTextures(1, &depthMapTexture);
+	backend.BindTexture(GL_TEXTURE_2D, depthMapTexture);
+	backend.TexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
 		SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	float borderColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	backend.TexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	backend.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
 	//attach texture to FBO
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapTexture, 0);
+	backend.BindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+	backend.FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapTexture, 0);
 
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
+	backend.DrawBuffer(GL_NONE);
+	backend.ReadBuffer(GL_NONE);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	backend.BindFramebuffer(GL_FRAMEBUFFER, myWindow.getFramebuffer());
 
 }
 
 void initUniforms() {
-	basicShader.useShaderProgram();
-
 	// create model matrix for teapot
 	model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-	modelLoc = glGetUniformLocation(basicShader.shaderProgram, "model");
 
 	// get view matrix for current camera
 	view = myCamera.getViewMatrix();
-	viewLoc = glGetUniformLocation(basicShader.shaderProgram, "view");
-	// send view matrix to shader
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 
 	// compute normal matrix for teapot
 	normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-	normalMatrixLoc = glGetUniformLocation(basicShader.shaderProgram, "normalMatrix");
 
 	// create projection matrix
-	projection = glm::perspective(glm::radians(45.0f),
-		(float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
-		0.1f, 100.0f);
-	projectionLoc = glGetUniformLocation(basicShader.shaderProgram, "projection");
-	// send projection matrix to shader
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+	myCamera.setAspect((float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height);
+	projection = myCamera.getProjectionMatrix();
 
 	//set the light direction (direction towards the light)
 	lightDir = glm::vec3(-9.09f, 9.39f, -1.80f);
 	lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-	lightDirLoc = glGetUniformLocation(basicShader.shaderProgram, "lightDir");
-	// send light dir to shader
-	glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view * lightRotation)) * lightDir));
+	lightDirUniform = glm::inverseTranspose(glm::mat3(view * lightRotation)) * lightDir;
 
 	//set light color
 	lightColor = glm::vec3(1.0f, 1.0f, 1.0f); //white light
-	lightColorLoc = glGetUniformLocation(basicShader.shaderProgram, "lightColor");
-	// send light color to shader
-	glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
+}
 
-	// fog density
-	fogDensityLoc = glGetUniformLocation(basicShader.shaderProgram, "fogDensity");
+// every shader variant is a separate program, the frame state is sent again after selecting one
+void applyFrameUniforms(gps::Shader& shader) {
+	// names a program does not use resolve to -1 and are ignored
+	GLuint program = shader.shaderProgram;
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	backend.UniformMatrix4fv(backend.GetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	backend.UniformMatrix4fv(backend.GetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	backend.UniformMatrix4fv(backend.GetUniformLocation(program, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+	backend.UniformMatrix3fv(backend.GetUniformLocation(program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	backend.Uniform3fv(backend.GetUniformLocation(program, "lightDir"), 1, glm::value_ptr(lightDirUniform));
+	backend.Uniform3fv(backend.GetUniformLocation(program, "lightColor"), 1, glm::value_ptr(lightColor));
+	backend.Uniform1f(backend.GetUniformLocation(program, "fogDensity"), fogDensity);
+	backend.Uniform3fv(backend.GetUniformLocation(program, "cameraFront"), 1, glm::value_ptr(camFrontDir));
+	backend.Uniform3fv(backend.GetUniformLocation(program, "cameraPos"), 1, glm::value_ptr(camPos));
+	backend.Uniform1i(backend.GetUniformLocation(program, "shadowMap"), 3);
+	backend.Uniform3fv(backend.GetUniformLocation(program, "ambientSH"), gps::SH_COEFFICIENT_COUNT, skyBox.getAmbient());
+
+	backend.Uniform1i(backend.GetUniformLocation(program, "clusterLights"), 4);
+	backend.Uniform1i(backend.GetUniformLocation(program, "clusterOffsets"), 5);
+	backend.Uniform1i(backend.GetUniformLocation(program, "clusterIndices"), 6);
+	backend.Uniform2f(backend.GetUniformLocation(program, "screenSize"),
+		(float)myWindow.getWindowDimensions().width, (float)myWindow.getWindowDimensions().height);
+	backend.Uniform1f(backend.GetUniformLocation(program, "clusterNear"), lightClusters.getNearPlane());
+	backend.Uniform1f(backend.GetUniformLocation(program, "clusterFar"), lightClusters.getFarPlane());
+
+	materialTextures.applyUniforms(program, MATERIAL_TEXTURE_UNIT);
+}
 
-	//spotlight -  flash
-	camPosLoc = glGetUniformLocation(basicShader.shaderProgram, "cameraPos");
-	camFrontDirLoc = glGetUniformLocation(basicShader.shaderProgram, "cameraFront");
+void initLights() {
+	lightClusters.Create();
+
+	// lamps on the base and blinking beacons, intensity holds the blink phase
+	baseLights.push_back({ glm::vec3(-9.0f, -0.3f, 1.0f), 4.0f, glm::vec3(1.0f, 0.85f, 0.6f), -1.0f });
+	baseLights.push_back({ glm::vec3(1.5f, -0.3f, -0.5f), 4.0f, glm::vec3(1.0f, 0.85f, 0.6f), -1.0f });
+	baseLights.push_back({ glm::vec3(-4.0f, 0.5f, -4.0f), 5.0f, glm::vec3(0.6f, 0.8f, 1.0f), -1.0f });
+	baseLights.push_back({ glm::vec3(-6.0f, 0.2f, 3.0f), 3.0f, glm::vec3(1.0f, 0.1f, 0.1f), 0.0f });
+	baseLights.push_back({ glm::vec3(3.0f, 0.2f, 2.0f), 3.0f, glm::vec3(0.1f, 1.0f, 0.1f), 1.5f });
+	baseLights.push_back({ glm::vec3(0.0f, 1.5f, -6.0f), 3.0f, glm::vec3(1.0f, 0.1f, 0.1f), 3.0f });
+
+	// fixed seed so every run stresses the same layout, its own generator so the snow keeps rand()
+	std::mt19937 random(1234);
+	auto randomInt = [&random](int range) { return (int)(random() % (unsigned int)range); };
+	for (int i = 0; i < 1000; i++) {
+		gps::PointLight light;
+		light.position = glm::vec3((float)(randomInt(4001) - 2000) / 100.0f, (float)(randomInt(301) - 150) / 100.0f, (float)(randomInt(4001) - 2000) / 100.0f);
+		light.radius = 1.0f + (float)randomInt(200) / 100.0f;
+		light.color = glm::vec3((float)randomInt(100) / 100.0f, (float)randomInt(100) / 100.0f, (float)randomInt(100) / 100.0f);
+		light.intensity = (float)randomInt(628) / 100.0f;
+		stressLights.push_back(light);
+	}
+}
 
-	// flash 
-	flashLoc = glGetUniformLocation(basicShader.shaderProgram, "flash");
-	glUniform1i(flashLoc, flash);
+gps::PointLight animateLight(const gps::PointLight& light, const glm::mat4& sceneModel) {
+	gps::PointLight animated = light;
+	// lights follow the scene rotation (Q/E) like the models they sit on
+	animated.position = glm::vec3(sceneModel * glm::vec4(light.position, 1.0f));
+	// negative phase means steady, the others blink
+	animated.intensity = light.intensity < 0.0f ? 1.0f : 0.5f + 0.5f * (float)sin(currentTime * 3.0 + light.intensity);
 
-	// grey
-	greyLoc = glGetUniformLocation(basicShader.shaderProgram, "grey");
-	glUniform1f(greyLoc, grey);
+	return animated;
+}
+
+void updateSceneLights() {
+	glm::mat4 sceneModel = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	sceneLights.clear();
+	for (size_t i = 0; i < baseLights.size(); i++)
+		sceneLights.push_back(animateLight(baseLights[i], sceneModel));
+
+	if (lightStress) {
+		for (size_t i = 0; i < stressLights.size(); i++)
+			sceneLights.push_back(animateLight(stressLights[i], sceneModel));
+	}
+
+	// bin the lights into the froxels of the current camera
+	lightClusters.setProjection(myCamera.getFov(), myCamera.getAspect(), myCamera.getNearPlane(), myCamera.getFarPlane());
+	lightClusters.Update(sceneLights, view);
+	lightClusters.Bind(4);
+
+	clusterAssignMs += lightClusters.getAssignMs();
+	clusterUploadMs += lightClusters.getUploadMs();
+	clusterFrames++;
 }
 
 glm::mat4 computeLightSpaceTrMatrix() {
@@ -768,48 +1057,73 @@ glm::mat4 computeLightSpaceTrMatrix() {
 	return lightSpaceTrMatrix;
 }
 
-void renderObject(gps::Shader shader, bool depthPass) {
+void updateAnimations() {
+	// advanced once per frame, every pass must see the same matrices
+	asteroidRotY += 20.0f * deltaTime;
+	earthRotY += 3.0f * deltaTime;
+
+	glm::mat4 trAst = glm::translate(glm::mat4(1.0f), glm::vec3(-4.036f, 6.9571f, -4.23668f));
+	glm::mat4 rotAst = glm::rotate(trAst, glm::radians(asteroidRotY), glm::vec3(0.0f, 1.0f, 0.0f));
+	asteroidModel = glm::translate(rotAst, glm::vec3(4.036f, -6.9571f, 4.23668f));
+
+	glm::mat4 trErt = glm::translate(glm::mat4(1.0f), glm::vec3(-52.0, 0.0f, -3.0));
+	glm::mat4 rotErt = glm::rotate(trErt, glm::radians(earthRotY), glm::vec3(0.0f, 1.0f, 0.0f));
+	earthModel = glm::translate(rotErt, glm::vec3(52.0f, 0.0f, 3.0f));
+}
+
+// mip levels the scene samples from the current camera position
+void requestTextureMips() {
+	float projectionScale = myWindow.getWindowDimensions().height / (2.0f * tanf(glm::radians(myCamera.getFov()) * 0.5f));
+	glm::vec3 cameraPosition = myCamera.getPosition();
+	glm::mat4 sceneModel = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	landscape.RequestMips(textureStreamer, sceneModel, cameraPosition, projectionScale);
+	unmovable.RequestMips(textureStreamer, sceneModel, cameraPosition, projectionScale);
+	asteroid1.RequestMips(textureStreamer, asteroidModel, cameraPosition, projectionScale);
+	earth.RequestMips(textureStreamer, earthModel, cameraPosition, projectionScale);
+	textureStreamer.Update();
+}
+
+void renderObject(gps::Shader& shader, bool depthPass) {
 	// select active shader program
 	shader.useShaderProgram();
 
+	// the depth passes use their own programs, look the locations up for this one
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	GLint modelLoc = backend.GetUniformLocation(shader.shaderProgram, "model");
+	GLint normalMatrixLoc = backend.GetUniformLocation(shader.shaderProgram, "normalMatrix");
+
 	// -- landscape : moon surface
 	model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	backend.UniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	backend.UniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
 	landscape.Draw(shader);
 
 	// -- unmovable objects
 	model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	backend.UniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	backend.UniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
 	unmovable.Draw(shader);
 
 	// asteroid animated
-	asteroidRotY += 20.0f * deltaTime;
-	glm::mat4 trAst = glm::translate(glm::mat4(1.0f), glm::vec3(-4.036f, 6.9571f, -4.23668f));
-	glm::mat4 rotAst = glm::rotate(trAst, glm::radians(asteroidRotY), glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 modelAst = glm::translate(rotAst, glm::vec3(4.036f, -6.9571f, 4.23668f));
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelAst));
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	backend.UniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(asteroidModel));
+	backend.UniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
 	asteroid1.Draw(shader);
 
 	// earth animated
-	earthRotY += 3.0f * deltaTime;
-	glm::mat4 trErt = glm::translate(glm::mat4(1.0f), glm::vec3(-52.0, 0.0f, -3.0));
-	glm::mat4 rotErt = glm::rotate(trErt, glm::radians(earthRotY), glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 modelErt = glm::translate(rotErt, glm::vec3(52.0f, 0.0f, 3.0f));
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelErt));
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	backend.UniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(earthModel));
+	backend.UniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
 	earth.Draw(shader);
 
 	if (snow) {
-		for (int i = 0; i < MAX_PARTICLES; ++i) {
-
-			glm::mat4 modelFlake = glm::translate(glm::mat4(1.0f), particles[i].position);
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelFlake));
-			glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-			flake.Draw(shader);
+		// all flakes in one draw, with the pass features plus INSTANCED
+		// the plain fallback cannot read instance matrices, skip them until it is linked
+		unsigned int features = shader.getVariant();
+		if (shader.useVariant(features | gps::SHADER_INSTANCED)) {
+			applyFrameUniforms(shader);
+			flake.DrawInstanced(shader, MAX_PARTICLES);
 		}
+		shader.useVariant(features);
 	}
 
 }
@@ -819,77 +1133,438 @@ void renderScene() {
 	// -- SHADOWS !!!!
 	// glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	depthMapShader.useShaderProgram();
+	// the camera rebuilds these only after it moved, turned or zoomed
+	view = myCamera.getViewMatrix();
+	projection = myCamera.getProjectionMatrix();
+	normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+
+	if (snow) {
+		uploadFlakeInstances();
+	}
+
+	lightSpaceMatrix = computeLightSpaceTrMatrix();
+	depthMapShader.useVariant(0);
+	applyFrameUniforms(depthMapShader);
 
 	// 1.
-	glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(computeLightSpaceTrMatrix()));
-	glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-	glClear(GL_DEPTH_BUFFER_BIT);
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	backend.Viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+	backend.BindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+	backend.Clear(GL_DEPTH_BUFFER_BIT);
 	renderObject(depthMapShader, true);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	backend.BindFramebuffer(GL_FRAMEBUFFER, myWindow.getFramebuffer());
 
 	// 2.
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+	backend.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	backend.Viewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
 
-	basicShader.useShaderProgram();
-	view = myCamera.getViewMatrix();
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+	scenePassTimer.Begin();
 
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-	glUniform1i(glGetUniformLocation(basicShader.shaderProgram, "shadowMap"), 3);
+	// depth only prepass, the main pass then shades each visible fragment once
+	if (depthPrepass) {
+		depthPrepassShader.useVariant(0);
+		applyFrameUniforms(depthPrepassShader);
+
+		backend.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		renderObject(depthPrepassShader, true);
+		backend.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		backend.DepthFunc(GL_EQUAL);
+		backend.DepthMask(GL_FALSE);
+	}
+
+	if (clusteredLighting) {
+		updateSceneLights();
+	}
+
+	// flashlight, grey and fog swap programs instead of branching in every fragment
+	basicShader.useVariant(basicShaderFeatures());
+	applyFrameUniforms(basicShader);
+
+	backend.ActiveTexture(GL_TEXTURE3);
+	backend.BindTexture(GL_TEXTURE_2D, depthMapTexture);
+	materialTextures.Bind(MATERIAL_TEXTURE_UNIT);
 
-	glUniformMatrix4fv(glGetUniformLocation(basicShader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(computeLightSpaceTrMatrix()));
 	renderObject(basicShader, false);
 
+	if (depthPrepass) {
+		backend.DepthMask(GL_TRUE);
+		backend.DepthFunc(GL_LESS);
+	}
+	scenePassTimer.End();
+
+	// compare the scene pass GPU time with and without the prepass, never inside timed frames
+	if (timingReport && !benchmarkRecording && currentTime - timerReportTime > 2.0) {
+		timerReportTime = currentTime;
+		std::cout << "Scene pass GPU time (prepass " << (depthPrepass ? "on" : "off") << "): "
+			<< scenePassTimer.getAverageMs() << " ms over " << scenePassTimer.getSampleCount() << " frames" << std::endl;
+		scenePassTimer.Reset();
+		std::cout << "Skybox GPU time (" << (skyboxTriangle ? "triangle" : "cube") << "): "
+			<< skyboxTimer.getAverageMs() << " ms over " << skyboxTimer.getSampleCount() << " frames" << std::endl;
+		skyboxTimer.Reset();
+
+		std::cout << "Texture streaming: " << textureStreamer.getResidentBytes() / (1024.0 * 1024.0) << " MB resident, "
+			<< textureStreamer.getRequestedBytes() / (1024.0 * 1024.0) << " MB requested, "
+			<< textureStreamer.getEvictedBytes() / (1024.0 * 1024.0) << " MB evicted of " << textureBudgetMB << " MB" << std::endl;
+
+		if (!textureUploader.isIdle())
+			std::cout << "Texture uploads: " << textureUploader.getUploadedBytes() / (1024.0 * 1024.0) << " MB done, "
+				<< textureUploader.getQueuedBytes() / (1024.0 * 1024.0) << " MB queued" << std::endl;
+
+		// per stage cost of the clustered lights
+		if (clusterFrames > 0) {
+			std::cout << "Clustered lights: " << lightClusters.getLightCount() << " lights, "
+				<< lightClusters.getIndexCount() << " froxel entries, CPU assign "
+				<< clusterAssignMs / clusterFrames << " ms, upload " << clusterUploadMs / clusterFrames << " ms" << std::endl;
+			clusterAssignMs = 0.0;
+			clusterUploadMs = 0.0;
+			clusterFrames = 0;
+		}
+	}
+
 	// if(flash)
 	if (flash) {
 		glm::vec3 camFlash = camPos + glm::vec3(0.0, 5.0f, 10.0f);
 		lightDir = camFlash;
-		glUniform3fv(lightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view)) * lightDir));
+		lightDirUniform = glm::inverseTranspose(glm::mat3(view)) * lightDir;
 	}
 
-	skyBox.Draw(skyboxShader, view, projection);
+	skyboxTimer.Begin();
+	if (skyboxTriangle)
+		skyBox.DrawFullscreen(skyboxTriangleShader, view, projection);
+	else
+		skyBox.Draw(skyboxShader, view, projection);
+	skyboxTimer.End();
 
 	// to calculate flash
-	basicShader.useShaderProgram();
 	camFrontDir = myCamera.getFront();
-	glUniform3fv(camFrontDirLoc, 1, glm::value_ptr(camFrontDir));
 	camPos = myCamera.getPosition();
-	glUniform3fv(camPosLoc, 1, glm::value_ptr(camPos));
 
-	std::cout << it << std::endl;
 	//std::cout << glm::to_string(particles[0].position) << std::endl;
 	//std::cout << windN << windS << windE << windV << std::endl;
 
 }
 
+void beginBenchmarkFrame() {
+	if (benchmarking && !benchmarkRecording) {
+		// frames at time 0 until the uploads are done, loading is not part of the timings
+		bool loaded = textureUploader.isIdle();
+		for (int i = 0; i < skyBox.getCount(); i++)
+			loaded = loaded && skyBox.isLoaded(i);
+		if (!loaded && ++benchmarkWarmupFrames < BENCHMARK_MAX_WARMUP_FRAMES)
+			return;
+
+		// the flakes start over from the same seed on every run
+		srand(BENCHMARK_SEED);
+		for (int i = 0; i < MAX_PARTICLES; i++)
+			initFlakes(i);
+		benchmarkRecording = true;
+		if (nullRenderer) {
+			nullBackend.Reset();
+			nullStatsFrame = frameIndex;
+		}
+		std::cout << "Benchmark recording " << frameLimit << " frames after " << benchmarkWarmupFrames << " warm up frames" << std::endl;
+	}
+
+	if (benchmarkRecording)
+		frameBenchmark.BeginFrame();
+}
+
+void writeBenchmark() {
+	if (inputLog.isReplaying()) {
+		frameBenchmark.setProperty("inputLog", inputReplayFile);
+	}
+	else {
+		frameBenchmark.setProperty("cameraPath", benchmarkPathFile);
+		frameBenchmark.setProperty("stepSeconds", BENCHMARK_STEP);
+		frameBenchmark.setProperty("seed", BENCHMARK_SEED);
+		frameBenchmark.setProperty("warmupFrames", benchmarkWarmupFrames);
+	}
+	frameBenchmark.setProperty("width", myWindow.getWindowDimensions().width);
+	frameBenchmark.setProperty("height", myWindow.getWindowDimensions().height);
+	gps::RenderBackend& backend = gps::RenderBackend::getCurrent();
+	frameBenchmark.setProperty("renderer", (const char*)backend.GetString(GL_RENDERER));
+	frameBenchmark.setProperty("vendor", (const char*)backend.GetString(GL_VENDOR));
+	frameBenchmark.setProperty("glVersion", (const char*)backend.GetString(GL_VERSION));
+	// the frame times are CPU only, these tell what they were spent issuing
+	if (nullRenderer) {
+		int frames = std::max(1, frameBenchmark.getRecordedFrames());
+		frameBenchmark.setProperty("commandsPerFrame", (double)nullBackend.getTotalCount() / frames);
+		frameBenchmark.setProperty("drawsPerFrame", (double)nullBackend.getDrawCount() / frames);
+		frameBenchmark.setProperty("verticesPerFrame", (double)nullBackend.getVertexCount() / frames);
+		frameBenchmark.setProperty("uploadedBytesPerFrame", (double)nullBackend.getUploadedBytes() / frames);
+	}
+	frameBenchmark.setProperty("build", __DATE__ " " __TIME__);
+#ifdef NDEBUG
+	frameBenchmark.setProperty("configuration", "release");
+#else
+	frameBenchmark.setProperty("configuration", "debug");
+#endif
+
+	if (!frameBenchmark.Write(benchmarkOutput)) {
+		std::cerr << "Could not write " << benchmarkOutput << std::endl;
+		return;
+	}
+
+	gps::FrameStatistics frame = frameBenchmark.getFrameStatistics();
+	gps::FrameStatistics cpu = frameBenchmark.getCpuStatistics();
+	gps::FrameStatistics gpu = frameBenchmark.getGpuStatistics();
+	std::cout << "Benchmark " << frameBenchmark.getRecordedFrames() << " frames written to " << benchmarkOutput << std::endl
+		<< "  frame p50 " << frame.p50 << " p95 " << frame.p95 << " p99 " << frame.p99 << " max " << frame.max << " ms" << std::endl
+		<< "  cpu   p50 " << cpu.p50 << " p95 " << cpu.p95 << " p99 " << cpu.p99 << " max " << cpu.max << " ms" << std::endl
+		<< "  gpu   p50 " << gpu.p50 << " p95 " << gpu.p95 << " p99 " << gpu.p99 << " max " << gpu.max << " ms" << std::endl;
+}
+
+void dumpFrame() {
+	char number[16];
+	snprintf(number, sizeof(number), "%06d", frameIndex + 1);
+	std::string fileName = frameDumpPrefix + number + ".tga";
+	if (!myWindow.SaveFrame(fileName))
+		std::cerr << "Could not write " << fileName << std::endl;
+}
+
+void endBenchmarkFrame() {
+	if (!benchmarkRecording)
+		return;
+
+	frameBenchmark.EndFrame();
+	if (frameBenchmark.isFinished()) {
+		writeBenchmark();
+		requestExit();
+	}
+}
+
 void cleanup() {
+	if (inputLog.isRecording())
+		std::cout << "Input log " << inputRecordFile << ": " << inputLog.getFrameCount() << " frames, " << inputLog.getBytes() / 1024.0 << " KB" << std::endl;
+	inputLog.Close();
+	frameBenchmark.Delete();
+	scenePassTimer.Delete();
+	skyboxTimer.Delete();
+	gps::RenderBackend::getCurrent().DeleteBuffers(1, &flakeInstanceVBO);
+	lightClusters.Delete();
+	materialTextures.Delete();
+	// before the uploader and streamer, a released texture drops its pending levels
+	unmovable.Delete();
+	asteroid1.Delete();
+	landscape.Delete();
+	earth.Delete();
+	flake.Delete();
+	skyBox.Delete();
+	textureStreamer.Delete();
+	gps::TextureManager::getInstance().setStreamer(NULL);
+	textureUploader.Delete();
+	gps::TextureManager::getInstance().setUploader(NULL);
 	myWindow.Delete();
+	if (nullRenderer)
+		nullBackend.printStats(frameIndex - nullStatsFrame);
 	//cleanup code for your own data
 }
 
-int main(int argc, const char* argv[]) {
+// every texture file of the scene, once
+std::vector<std::string> sceneTexturePaths() {
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < sizeof(materialLibraries) / sizeof(materialLibraries[0]); i++) {
+		std::vector<std::string> libraryPaths = gps::Model3D::getTexturePaths(materialLibraries[i][0], materialLibraries[i][1]);
+		paths.insert(paths.end(), libraryPaths.begin(), libraryPaths.end());
+	}
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+	return paths;
+}
+
+// offline build of the KTX2 texture caches, runs without a window
+void transcodeTextures() {
+	std::vector<std::string> paths = sceneTexturePaths();
+
+	// glfw is not initialized in this mode, so no glfwGetTime
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int cached = gps::TextureManager::TranscodeFiles(paths);
+	std::cout << "Transcoded textures: " << cached << " of " << paths.size() << " cached in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	int cachedSkyBoxes = 0;
+	for (int i = 0; i < SKYBOX_COUNT; i++) {
+		if (gps::SkyBox::BuildCache(std::vector<const GLchar*>(skyBoxFaceSets[i], skyBoxFaceSets[i] + 6)))
+			cachedSkyBoxes++;
+	}
+	std::cout << "Transcoded skyboxes: " << cachedSkyBoxes << " of " << SKYBOX_COUNT << " cached in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+}
 
+// flip, channel packing and premultiply on the shipped textures, against the plain byte loops
+void benchmarkTextures() {
+	const int repeats = 5;
+	gps::PreprocessTimings timings = gps::benchmarkPreprocessing(sceneTexturePaths(), repeats);
+	double megabytes = timings.bytes / (1024.0 * 1024.0);
+
+	std::cout << "Texture preprocessing: " << timings.images << " images, " << megabytes << " MB RGBA8, ms per pass (reference)" << std::endl;
+	std::cout << "  flip        " << timings.flipMs << " (" << timings.flipReferenceMs << ")" << std::endl;
+	std::cout << "  pack        " << timings.packMs << " (" << timings.packReferenceMs << ") to R, RG and RGB" << std::endl;
+	std::cout << "  expand      " << timings.expandMs << " (" << timings.expandReferenceMs << ") from R, RG and RGB" << std::endl;
+	std::cout << "  premultiply " << timings.premultiplyMs << " (" << timings.premultiplyReferenceMs << ")" << std::endl;
+}
 
-	try {
-		initOpenGLWindow();
+// --report prints the GPU times of the scene pass and the skybox, texture streaming, uploads and
+//   clustered lights every 2 seconds, not while a benchmark or replay is timed
+// --threads N sets the size of the worker pool, used to compare startup on different core counts
+// --texture-budget MB sets the video memory the streamed textures may use
+// --transcode builds the compressed texture and skybox caches, skybox ambient included, and exits
+// --texture-bench times the texture preprocessing passes and exits
+// --material-textures draws from texture arrays or bindless handles, without streaming
+// --benchmark PATH flies the camera path file at 60 simulated frames per second with snow and no vsync,
+//   for --frames N after the warm up (once along the path by default), and writes the frame times to --benchmark-output FILE (benchmark.json)
+// --record FILE writes the frame times and every input event of the session to FILE
+// --replay FILE plays such a session again at its frame times without vsync and writes the time of every frame to --benchmark-output
+// --frames N also ends a normal run or a replay after N frames
+// --headless draws offscreen into a framebuffer without a display, combine it with --frames, --benchmark or --replay
+// --resolution WxH sets the size of the window or of the offscreen framebuffer (1024x768)
+// --dump-frames PREFIX writes every frame to PREFIX000001.tga, PREFIX000002.tga and so on
+// --null-renderer runs the frame loop without a window or GL and counts the commands it would issue,
+//   for --frames N (600) or along --benchmark or --replay, to time the CPU side of a frame
+void parseArguments(int argc, const char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--threads" && i + 1 < argc)
+			gps::ThreadPool::setSharedThreadCount((unsigned int)std::max(1, atoi(argv[++i])));
+		else if (argument == "--texture-budget" && i + 1 < argc)
+			textureBudgetMB = std::max(1.0, atof(argv[++i]));
+		else if (argument == "--report")
+			timingReport = true;
+		else if (argument == "--transcode")
+			transcodeOnly = true;
+		else if (argument == "--texture-bench")
+			textureBenchmark = true;
+		else if (argument == "--material-textures")
+			materialTexturesEnabled = true;
+		else if (argument == "--benchmark" && i + 1 < argc)
+			benchmarkPathFile = argv[++i];
+		else if (argument == "--frames" && i + 1 < argc)
+			frameLimit = std::max(1, atoi(argv[++i]));
+		else if (argument == "--benchmark-output" && i + 1 < argc)
+			benchmarkOutput = argv[++i];
+		else if (argument == "--record" && i + 1 < argc)
+			inputRecordFile = argv[++i];
+		else if (argument == "--replay" && i + 1 < argc)
+			inputReplayFile = argv[++i];
+		else if (argument == "--headless")
+			headless = true;
+		else if (argument == "--resolution" && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &windowWidth, &windowHeight) != 2 || windowWidth <= 0 || windowHeight <= 0) {
+				std::cerr << "Resolution " << argv[i] << " is not WxH, using 1024x768" << std::endl;
+				windowWidth = 1024;
+				windowHeight = 768;
+			}
+		}
+		else if (argument == "--dump-frames" && i + 1 < argc)
+			frameDumpPrefix = argv[++i];
+		else if (argument == "--null-renderer")
+			nullRenderer = true;
+		else
+			std::cerr << "Unknown argument " << argument << std::endl;
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	parseArguments(argc, argv);
+	if (transcodeOnly) {
+		transcodeTextures();
+		return EXIT_SUCCESS;
 	}
-	catch (const std::exception& e) {
-		std::cerr << e.what() << std::endl;
+	if (textureBenchmark) {
+		benchmarkTextures();
+		return EXIT_SUCCESS;
+	}
+	tourPath.Load("paths/tour.path");
+	if (!benchmarkPathFile.empty()) {
+		if (!benchmarkPath.Load(benchmarkPathFile))
+			return EXIT_FAILURE;
+		benchmarking = true;
+		if (frameLimit == 0)
+			frameLimit = (int)ceil(benchmarkPath.getDuration() / BENCHMARK_STEP);
+	}
+	if (!inputReplayFile.empty()) {
+		if (benchmarking) {
+			std::cerr << "--replay and --benchmark cannot be combined" << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (!inputLog.OpenReplay(inputReplayFile)) {
+			std::cerr << "Could not read the input log " << inputReplayFile << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Replaying " << inputLog.getFrameCount() << " frames from " << inputReplayFile << std::endl;
+	}
+	else if (!inputRecordFile.empty() && !inputLog.OpenRecording(inputRecordFile)) {
+		std::cerr << "Could not create the input log " << inputRecordFile << std::endl;
 		return EXIT_FAILURE;
 	}
 
+	if (nullRenderer) {
+		// nothing is drawn, so nothing to dump, and the material textures read their data back from GL
+		if (!frameDumpPrefix.empty() || materialTexturesEnabled) {
+			std::cerr << "--null-renderer cannot be combined with --dump-frames or --material-textures" << std::endl;
+			return EXIT_FAILURE;
+		}
+		// before anything is created, every name comes from the same backend
+		gps::RenderBackend::setCurrent(&nullBackend);
+		myWindow.setWindowDimensions(WindowDimensions{ windowWidth, windowHeight });
+		if (frameLimit == 0 && !benchmarking && !inputLog.isReplaying())
+			frameLimit = NULL_RENDERER_FRAMES;
+		std::cout << "Null renderer: " << windowWidth << "x" << windowHeight << ", commands are counted, not executed" << std::endl;
+	}
+	else {
+		try {
+			initOpenGLWindow();
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		// frame times are not held to the display refresh
+		if (benchmarking || inputLog.isReplaying())
+			glfwSwapInterval(0);
+	}
+	if (benchmarking) {
+		frameBenchmark.Create(frameLimit);
+		snow = true;
+	}
+	if (inputLog.isReplaying()) {
+		// every replayed frame is timed, loading included as it was recorded
+		frameBenchmark.Create(frameLimit > 0 ? std::min(frameLimit, inputLog.getFrameCount()) : inputLog.getFrameCount());
+		benchmarkRecording = true;
+	}
+
 	initOpenGLState();
+	// the uploader maps buffers and the streamer feeds it, without them every level is specified at once
+	if (!nullRenderer) {
+		if (gps::TextureManager::getInstance().initCompression())
+			std::cout << "Loading textures block compressed" << std::endl;
+		textureUploader.Create(4, TEXTURE_UPLOAD_BUDGET_MB);
+		textureStreamer.Create(&textureUploader, textureBudgetMB);
+	}
+	// material textures copy whole mip chains, they are uploaded in one go
+	if (!materialTexturesEnabled && !nullRenderer) {
+		gps::TextureManager::getInstance().setUploader(&textureUploader);
+		gps::TextureManager::getInstance().setStreamer(&textureStreamer);
+	}
+	double textureLoadStart = getTime();
 	initModels();
 	initStarfield();
+	if (materialTexturesEnabled)
+		initMaterialTextures();
+	std::cout << "Models and skybox loaded in " << (getTime() - textureLoadStart) * 1000.0 << " ms" << std::endl;
+	gps::TextureManager::getInstance().printStats();
+	initFlakeInstances();
 	initShaders();
 	initUniforms();
 	initFBO();
-	setWindowCallbacks();
+	initLights();
+	scenePassTimer.Create();
+	skyboxTimer.Create();
+	if (!nullRenderer)
+		setWindowCallbacks();
 
 	for (size_t i = 0; i < MAX_PARTICLES; i++)
 	{
@@ -897,15 +1572,36 @@ int main(int argc, const char* argv[]) {
 	}
 
 	glCheckError();
+	// loading is not part of the per frame counts
+	nullBackend.Reset();
 	// application loop
-	while (!glfwWindowShouldClose(myWindow.getWindow())) {
+	while (!exitRequested && (!myWindow.getWindow() || !glfwWindowShouldClose(myWindow.getWindow()))) {
+		beginBenchmarkFrame();
 		processDeltaSpeed();
+		pollShaders();
+		textureUploader.Update();
+		skyBox.Update(currentTime);
 		processMovement();
+		updateAnimations();
+		requestTextureMips();
 		renderScene();
-		updateFlakes(deltaTime);
-
-		glfwPollEvents();
-		glfwSwapBuffers(myWindow.getWindow());
+		if (!benchmarking || benchmarkRecording)
+			updateFlakes(deltaTime);
+		if (benchmarkRecording)
+			frameBenchmark.EndCommands();
+
+		if (!frameDumpPrefix.empty())
+			dumpFrame();
+
+		pollInput();
+		if (!nullRenderer)
+			myWindow.SwapBuffers();
+		endBenchmarkFrame();
+
+		// the benchmark and the replay end on their own, once their frames are timed
+		frameIndex++;
+		if (frameLimit > 0 && frameIndex >= frameLimit && !benchmarkRecording)
+			requestExit();
 	}
 
 	cleanup();
@@ -1,8 +1,12 @@
 #version 410 core
+#ifdef MATERIAL_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 in vec3 fPosition;
 in vec3 fNormal;
 in vec2 fTexCoords;
+in vec4 fPosEye;
 in vec4 fragPosLightSpace;
 
 out vec4 fColor;
@@ -10,7 +14,6 @@ out vec4 fColor;
 // fog
 uniform float fogDensity;
 //matrices
-uniform mat4 model;
 uniform mat4 view;
 uniform mat3 normalMatrix;
 //lighting
@@ -20,14 +23,70 @@ uniform sampler2D shadowMap;
 // textures
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
+// material of the mesh, -1 when its textures are bound to the samplers above
+uniform int materialIndex = -1;
+
+#if defined(MATERIAL_ARRAYS) || defined(MATERIAL_BINDLESS)
+// where the textures of every material are, see MaterialTextures
+// arrays: x array and y layer, x is ~0 without a texture
+// bindless: xy the 64 bit handle, 0 without a texture
+struct MaterialSlots {
+	uvec4 diffuse;
+	uvec4 specular;
+};
+layout(std140) uniform Materials {
+	MaterialSlots materials[MAX_MATERIALS];
+};
+#ifdef MATERIAL_ARRAYS
+uniform sampler2DArray materialArrays[MATERIAL_ARRAY_COUNT];
+#endif
+
+vec4 sampleSlot(uvec4 slot) {
+#ifdef MATERIAL_BINDLESS
+	if (slot.xy == uvec2(0u))
+		return vec4(0.0, 0.0, 0.0, 1.0);
+	return texture(sampler2D(slot.xy), fTexCoords);
+#else
+	// the slot comes from a uniform index, the same for the whole draw
+	if (slot.x >= uint(MATERIAL_ARRAY_COUNT))
+		return vec4(0.0, 0.0, 0.0, 1.0);
+	return texture(materialArrays[slot.x], vec3(fTexCoords, float(slot.y)));
+#endif
+}
+#endif
+
+vec3 diffuseColor() {
+#if defined(MATERIAL_ARRAYS) || defined(MATERIAL_BINDLESS)
+	if (materialIndex >= 0)
+		return sampleSlot(materials[materialIndex].diffuse).rgb;
+#endif
+	return texture(diffuseTexture, fTexCoords).rgb;
+}
+
+vec3 specularColor() {
+#if defined(MATERIAL_ARRAYS) || defined(MATERIAL_BINDLESS)
+	if (materialIndex >= 0)
+		return sampleSlot(materials[materialIndex].specular).rgb;
+#endif
+	return texture(specularTexture, fTexCoords).rgb;
+}
+
+// diffuse light of the skybox as order 2 spherical harmonics, linear, see SphericalHarmonics.hpp
+uniform vec3 ambientSH[9];
+uniform float ambientIntensity = 1.0;
+
+vec3 environmentAmbient(vec3 n) {
+	return ambientSH[0]
+		+ ambientSH[1] * n.y + ambientSH[2] * n.z + ambientSH[3] * n.x
+		+ ambientSH[4] * (n.x * n.y) + ambientSH[5] * (n.y * n.z) + ambientSH[6] * (3.0 * n.z * n.z - 1.0)
+		+ ambientSH[7] * (n.x * n.z) + ambientSH[8] * (n.x * n.x - n.y * n.y);
+}
 
 //components
 vec3 ambient;
-float ambientStrength = 0.2;
 vec3 diffuse;
 vec3 specular;
 float specularStrength = 0.5;
-vec4 fPosEye;
 
 float constant = 1.0;
 float linear = 0.0045;
@@ -37,8 +96,6 @@ float shininess = 12.0;
 // spotlight (flash)
 uniform vec3 cameraFront;
 uniform vec3 cameraPos;
-uniform bool flash;
-uniform bool grey;
 
 vec3 ambientf;
 vec3 diffusef;
@@ -53,8 +110,7 @@ float cutOff = 0.9763;
 float outerCutOff = 0.9537;
 
 void computeDirLight() {
-    //compute eye space coordinates
-	fPosEye = view * model * vec4(fPosition, 1.0);
+    //eye space coordinates are interpolated from the vertex shader
 	vec3 normalEye = normalize(normalMatrix * fNormal);
 
     //normalize light direction
@@ -68,8 +124,9 @@ void computeDirLight() {
 	//compute attenuation
 	float att = 1.0 / (constant + linear * dist + quadratic * (dist * dist));
 
-    //compute ambient light
-	ambient = att * ambientStrength * lightColor;
+    //compute ambient light from the environment, the cube map directions are world space
+	vec3 normalWorld = transpose(mat3(view)) * normalEye;
+	ambient = ambientIntensity * max(environmentAmbient(normalWorld), 0.0);
 
     //compute diffuse light
 	diffuse = att * max(dot(normalEye, lightDirN), 0.0) * lightColor;
@@ -82,17 +139,17 @@ void computeDirLight() {
 
 void computeFlash(){
 
-	ambientf = _ambient * texture(diffuseTexture, fTexCoords).rgb;
+	ambientf = _ambient * diffuseColor();
 
 	vec3 norm = normalize(fNormal);
 	vec3 lightDirN = normalize(cameraPos - fPosition);
 	float diff = max(dot(norm, lightDirN), 0.0f);
-	diffusef = _diffuse * diff * texture(diffuseTexture, fTexCoords).rgb;
+	diffusef = _diffuse * diff * diffuseColor();
 
 	vec3 viewDirN = normalize(cameraPos - fPosition);
     vec3 reflectDir = reflect(-lightDir, norm);  
     float spec = pow(max(dot(viewDirN, reflectDir), 0.0), shininess);
-    specularf = _specular * spec * texture(diffuseTexture, fTexCoords).rgb;
+    specularf = _specular * spec * diffuseColor();
 
 	float theta = dot(lightDirN, normalize(-cameraFront));
 	float epsilon = cutOff - outerCutOff;
@@ -136,35 +193,92 @@ float computeFog() {
 	return clamp(fogFactor, 0.0, 1.0);
 }
 
+#ifdef CLUSTERED
+// point lights binned into froxels on the CPU, see LightClusters
+const ivec3 clusterGrid = ivec3(16, 9, 24);
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterOffsets;
+uniform usamplerBuffer clusterIndices;
+uniform vec2 screenSize;
+uniform float clusterNear;
+uniform float clusterFar;
+
+vec3 computeClusterLights() {
+	vec3 normalEye = normalize(normalMatrix * fNormal);
+	vec3 viewDir = normalize(-fPosEye.xyz);
+	vec3 albedo = diffuseColor();
+	vec3 specularMap = specularColor();
+
+	// froxel of this fragment, same exponential depth slices as on the CPU
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / screenSize * vec2(clusterGrid.xy)), ivec2(0), clusterGrid.xy - 1);
+	float depth = max(-fPosEye.z, clusterNear);
+	int slice = clamp(int(log(depth / clusterNear) / log(clusterFar / clusterNear) * float(clusterGrid.z)), 0, clusterGrid.z - 1);
+	int cluster = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+
+	uvec2 range = texelFetch(clusterOffsets, cluster).xy;
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < range.y; i++) {
+		int light = int(texelFetch(clusterIndices, int(range.x + i)).r);
+		vec4 positionRadius = texelFetch(clusterLights, light * 2);
+		vec3 color = texelFetch(clusterLights, light * 2 + 1).rgb;
+
+		vec3 toLight = positionRadius.xyz - fPosEye.xyz;
+		float dist = length(toLight);
+		// smooth falloff reaching zero at the radius the light was binned with
+		float falloff = clamp(1.0 - dist / positionRadius.w, 0.0, 1.0);
+		falloff *= falloff;
+
+		vec3 lightDirN = toLight / max(dist, 0.0001);
+		float diff = max(dot(normalEye, lightDirN), 0.0);
+		vec3 reflectDir = reflect(-lightDirN, normalEye);
+		float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+		result += falloff * color * (diff * albedo + specularStrength * spec * specularMap);
+	}
+
+	return result;
+}
+#endif
+
 void main() {
 
 	computeDirLight();
 
-	ambient *= texture(diffuseTexture, fTexCoords).rgb;
-	diffuse *= texture(diffuseTexture, fTexCoords).rgb;
-	specular *= texture(specularTexture, fTexCoords).rgb;
+	ambient *= diffuseColor();
+	diffuse *= diffuseColor();
+	specular *= specularColor();
 
 	// compute spot light
-	
-	if(flash){
-		computeFlash();
-		ambient *= attenuation;
-		diffuse *= attenuation;
-		specular *= attenuation;
-	}
-		
+#ifdef FLASH
+	computeFlash();
+	ambient *= attenuation;
+	diffuse *= attenuation;
+	specular *= attenuation;
+#endif
 
 	// modulate with shadow
+#ifdef SHADOWS
 	float shadow = computeShadow();
+#else
+	float shadow = 0.0;
+#endif
+
+	vec3 color = min((ambient + (1.0 - shadow) * diffuse) + (1.0 - shadow) * specular, 1.0);
+
+#ifdef CLUSTERED
+	color = min(color + computeClusterLights(), 1.0);
+#endif
+
+#ifdef GREY
+	color = vec3(vec3(color).y);
+#endif
 
 	// modualte with fog
+#ifdef FOG
 	float fogFactor = computeFog();
 	vec4 fogColor = vec4(0.5, 0.5, 0.5, 1.0);
-	vec3 color = min((ambient + (1.0 - shadow) * diffuse) + (1.0 - shadow) * specular, 1.0);
-
-	if(grey){
-		color = vec3(vec3(color).y);
-	}
 	fColor = mix(fogColor, vec4(color, 1.0), fogFactor);
+#else
+	fColor = vec4(color, 1.0);
+#endif
 
 }
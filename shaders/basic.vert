@@ -3,6 +3,10 @@
 layout(location=0) in vec3 vPosition;
 layout(location=1) in vec3 vNormal;
 layout(location=2) in vec2 vTexCoords;
+#ifdef INSTANCED
+// per instance model matrix, takes locations 3 to 6
+layout(location=3) in mat4 instanceModel;
+#endif
 
 out vec3 fPosition;
 out vec3 fNormal;
@@ -17,8 +21,14 @@ uniform mat4 projection;
 uniform mat4 lightSpaceTrMatrix;
 uniform	mat3 normalMatrix;
 
+// keeps depth identical to depthPrepass.vert for the GL_EQUAL main pass
+invariant gl_Position;
+
 void main() 
 {
+#ifdef INSTANCED
+	mat4 model = instanceModel;
+#endif
 	fPosition = vPosition;
 	//fNormal = vNormal;
 	fNormal = normalize(normalMatrix * vNormal);
@@ -1,10 +1,16 @@
 #version 410 core
 layout(location=0) in vec3 vPosition;
+#ifdef INSTANCED
+layout(location=3) in mat4 instanceModel;
+#endif
 
 uniform mat4 lightSpaceTrMatrix;
 uniform mat4 model;
 
 void main()
 {
+#ifdef INSTANCED
+	mat4 model = instanceModel;
+#endif
 	gl_Position = lightSpaceTrMatrix * model * vec4(vPosition, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 410 core
+layout(location=0) in vec3 vPosition;
+#ifdef INSTANCED
+layout(location=3) in mat4 instanceModel;
+#endif
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// must match basic.vert bit for bit, the main pass tests depth with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+#ifdef INSTANCED
+	mat4 model = instanceModel;
+#endif
+	gl_Position = projection * view * model * vec4(vPosition, 1.0f);
+}
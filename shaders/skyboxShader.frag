@@ -4,8 +4,12 @@ in vec3 textureCoordinates;
 out vec4 color;
 
 uniform samplerCube skybox;
+// the cube map faded from while switching, blend goes from 0 to 1
+uniform samplerCube previousSkybox;
+uniform float blend = 1.0;
 
 void main()
 {
-    color = texture(skybox, textureCoordinates);
+    vec4 previousColor = texture(previousSkybox, textureCoordinates);
+    color = mix(previousColor, texture(skybox, textureCoordinates), blend);
 }
@@ -0,0 +1,16 @@
+#version 410 core
+
+in vec4 farPoint;
+out vec4 color;
+
+uniform samplerCube skybox;
+// the cube map faded from while switching, blend goes from 0 to 1
+uniform samplerCube previousSkybox;
+uniform float blend = 1.0;
+
+void main()
+{
+    vec3 direction = farPoint.xyz / farPoint.w;
+    vec4 previousColor = texture(previousSkybox, direction);
+    color = mix(previousColor, texture(skybox, direction), blend);
+}
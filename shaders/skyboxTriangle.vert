@@ -0,0 +1,15 @@
+#version 410 core
+
+// one triangle covering the screen, the corners come from gl_VertexID so there is no vertex buffer
+out vec4 farPoint;
+
+uniform mat4 inverseViewProjection;
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    // on the far plane, only the texels the scene left at the cleared depth pass the test
+    gl_Position = vec4(position, 1.0, 1.0);
+    // the view has no translation, the far plane point is the view ray
+    farPoint = inverseViewProjection * gl_Position;
+}